@@ -0,0 +1,371 @@
+// attacks.cc - attack tables, built by the compiler
+
+#include "attacks.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHESSY_X86 1
+#endif
+
+#include "cpu.h"
+
+namespace chessy {
+
+SliderBackend g_slider_backend = kMagicSliders;
+
+// Found offline by trial of sparse random numbers. Any number works as long
+// as no two occupancies with different attack sets share an index.
+static constexpr uint64_t kRookMagics[64] = {
+  0x1080004008801020ull, 0x0840092002c03000ull,
+  0x1900200010400900ull, 0x0880100008000480ull,
+  0x4200100420080200ull, 0x8100020100080400ull,
+  0x0200040110886200ull, 0x0200008040220411ull,
+  0x0404800084400220ull, 0x0000401000402000ull,
+  0x0086001081220440ull, 0x0408800800100280ull,
+  0x000a001201040820ull, 0x8848800200840080ull,
+  0x4001000100040200ull, 0x0442000102105084ull,
+  0x9080010020804100ull, 0x0040404000201009ull,
+  0x0000808010002009ull, 0x2200090021d00100ull,
+  0x0008008008040080ull, 0x0004004002010040ull,
+  0x0011040008015042ull, 0x00000a0001768104ull,
+  0x0000800080204009ull, 0x2010004140002001ull,
+  0x9800200280100080ull, 0x1000100080080080ull,
+  0x0442000a00049020ull, 0x2100040080020080ull,
+  0x0800120400900148ull, 0x0010040a00128541ull,
+  0x2800804000800030ull, 0x1010002000400041ull,
+  0x4000200011004100ull, 0x0610008410800800ull,
+  0x0400802402800800ull, 0xc100020080800400ull,
+  0x0002000802000401ull, 0x0182085882000401ull,
+  0x0220204000808000ull, 0x2860100040024022ull,
+  0x0001002004110040ull, 0x99101042000a0020ull,
+  0x0004080004008080ull, 0x0010040002008080ull,
+  0x2012004881020004ull, 0x8300842444820011ull,
+  0x0088403882010200ull, 0x0820400080210100ull,
+  0x0110910040a00300ull, 0x0801100280080480ull,
+  0x0242009008200600ull, 0x1002000489500200ull,
+  0x0040800200010080ull, 0x0091800041000080ull,
+  0x0000209300488001ull, 0x04c1002414824001ull,
+  0x020020000b001041ull, 0x7000100004200901ull,
+  0x8002002004100802ull, 0x30010002084c0007ull,
+  0x0888221800813004ull, 0x4000002840840112ull,
+};
+
+static constexpr uint64_t kBishopMagics[64] = {
+  0xa010041108003100ull, 0x006082020a002900ull,
+  0x6810010619200000ull, 0x08281a0520000408ull,
+  0x0001104001000400ull, 0x0018901008048400ull,
+  0x00040a0210245280ull, 0x000200210808a402ull,
+  0x9140048410821200ull, 0x0800091010820041ull,
+  0x20504804832202c0ull, 0x0100091401081000ull,
+  0x8021011140000012ull, 0x0810020804450400ull,
+  0x208b0542109008a2ull, 0x0080084a08040204ull,
+  0x0040e2a80811244cull, 0x2505022008008108ull,
+  0x0430220100420040ull, 0x010a040420220040ull,
+  0x1105000290400000ull, 0x0093001200822120ull,
+  0x4000a62048043004ull, 0x280120048a015004ull,
+  0x006090002a020814ull, 0x44042000240800d0ull,
+  0x01102800040a4400ull, 0x1004080080220040ull,
+  0x0001001011004024ull, 0x0010044000805040ull,
+  0x0914041200820100ull, 0x0004821012821480ull,
+  0x0024040500c05021ull, 0x0088611002080200ull,
+  0x0116080a00040020ull, 0x4000020080080080ull,
+  0x2450450140840040ull, 0x0000880201484100ull,
+  0x0222020404020092ull, 0x8081110600002e00ull,
+  0x2842101105000801ull, 0x1100809008001025ull,
+  0x00020202221c0400ull, 0x0422014022009020ull,
+  0x0210046102100c00ull, 0xc004008082029102ull,
+  0x00aa461801101200ull, 0x0404080080201108ull,
+  0x020542108c205002ull, 0x0410544804100100ull,
+  0x0040910841100000ull, 0x0400200042021100ull,
+  0x00004204850400c0ull, 0x0200100410a42102ull,
+  0x1040020801210102ull, 0x0805040410420000ull,
+  0x2884804130100200ull, 0x800c262201242000ull,
+  0x1058000194108800ull, 0x0014221054420204ull,
+  0x0104000012a02200ull, 0x0200881003300100ull,
+  0x0140400202840100ull, 0x0402020801010201ull,
+};
+
+static constexpr uint64_t Bit(int rank, int file) {
+  return 1ull << (rank * kRow + file);
+}
+
+static constexpr int Abs(int x) {
+  return x < 0 ? -x : x;
+}
+
+// The slow way: walk each ray until we fall off the board or hit a piece.
+// With |relevant| it instead stops one short of the edge, since pieces on
+// the last square of a ray can't block anything behind them.
+static constexpr uint64_t SlowAttacks(const int (&steps)[4][2], int square,
+                                      uint64_t occupied, bool relevant) {
+  uint64_t res = 0;
+  for (int n = 0; n < 4; ++n) {
+    int dr = steps[n][0];
+    int df = steps[n][1];
+    for (int r = square / kRow + dr, f = square % kRow + df; OnBoard(r, f);
+         r += dr, f += df) {
+      if (relevant && !OnBoard(r + dr, f + df))
+        break;
+      res |= Bit(r, f);
+      if (occupied & Bit(r, f))
+        break;
+    }
+  }
+  return res;
+}
+
+template <size_t N>
+static constexpr SliderTable<N> MakeSliderTable(
+    const uint64_t (&magics)[64], const int (&steps)[4][2]) {
+  SliderTable<N> res{};
+  uint32_t next = 0;
+  for (int square = 0; square < 64; ++square) {
+    Magic& m = res.magics[square];
+    m.mask = SlowAttacks(steps, square, 0, true);
+    m.magic = magics[square];
+    m.offset = next;
+    int bits = 0;
+    for (uint64_t x = m.mask; x; x &= x - 1) {
+      ++bits;
+    }
+    m.shift = 64 - bits;
+    // Enumerate every subset of the mask with the carry-rippler trick. It
+    // counts up through them in order, which is the order PEXT numbers them.
+    uint64_t subset = 0;
+    uint32_t pext = 0;
+    do {
+      uint64_t attacks = SlowAttacks(steps, square, subset, false);
+      uint64_t& slot = res.attacks[m.Index(subset)];
+      if (slot && slot != attacks)
+        throw "bad magic";  // Fails the build.
+      slot = attacks;
+      res.pext[m.offset + pext++] = attacks;
+      subset = (subset - m.mask) & m.mask;
+    } while (subset);
+    next += 1u << bits;
+  }
+  if (next != N)
+    throw "wrong table size";
+  return res;
+}
+
+static constexpr LineTable MakeLineTable() {
+  LineTable res{};
+  for (int square = 0; square < 64; ++square) {
+    int rank = square / kRow;
+    int file = square % kRow;
+    for (int n = 0; n < 8; ++n) {
+      int dr = kKingSteps[n][0];
+      int df = kKingSteps[n][1];
+      // Both rays through |square| in this direction, plus itself.
+      uint64_t line = Bit(rank, file);
+      for (int r = rank + dr, f = file + df; OnBoard(r, f); r += dr, f += df)
+        line |= Bit(r, f);
+      for (int r = rank - dr, f = file - df; OnBoard(r, f); r -= dr, f -= df)
+        line |= Bit(r, f);
+      uint64_t path = 0;
+      for (int r = rank + dr, f = file + df; OnBoard(r, f);
+           r += dr, f += df) {
+        res.between[square][r * kRow + f] = path;
+        res.line[square][r * kRow + f] = line;
+        path |= Bit(r, f);
+      }
+    }
+  }
+  return res;
+}
+
+static constexpr uint64_t LeaperAttacks(const int (*steps)[2], int count,
+                                        int rank, int file) {
+  uint64_t res = 0;
+  for (int n = 0; n < count; ++n) {
+    if (OnBoard(rank + steps[n][0], file + steps[n][1]))
+      res |= Bit(rank + steps[n][0], file + steps[n][1]);
+  }
+  return res;
+}
+
+static constexpr LeaperTable MakeLeaperTable() {
+  LeaperTable res{};
+  for (int rank = 0; rank < kRow; ++rank) {
+    for (int file = 0; file < kRow; ++file) {
+      int n = rank * kRow + file;
+      res.knight[n] = LeaperAttacks(kKnightSteps, 8, rank, file);
+      res.king[n] = LeaperAttacks(kKingSteps, 8, rank, file);
+      res.pawn[kWhite][n] = LeaperAttacks(kBishopSteps, 2, rank, file);
+      res.pawn[kBlack][n] = LeaperAttacks(kBishopSteps + 2, 2, rank, file);
+    }
+  }
+  // The 0x88 difference of two squares is (dr * 16 + df), which is unique
+  // for every offset, so it can stand in for the pair.
+  for (int dr = -7; dr <= 7; ++dr) {
+    for (int df = -7; df <= 7; ++df) {
+      uint8_t& kinds = res.deltas[dr * 0x10 + df + 119];
+      if (!dr && !df)
+        continue;
+      if (!dr || !df)
+        kinds |= (1 << kRook) | (1 << kQueen);
+      if (Abs(dr) == Abs(df))
+        kinds |= (1 << kBishop) | (1 << kQueen);
+      if (Abs(dr * df) == 2)
+        kinds |= 1 << kKnight;
+      if (Abs(dr) <= 1 && Abs(df) <= 1)
+        kinds |= 1 << kKing;
+    }
+  }
+  return res;
+}
+
+constexpr SliderTable<102400> g_rook_table =
+    MakeSliderTable<102400>(kRookMagics, kRookSteps);
+constexpr SliderTable<5248> g_bishop_table =
+    MakeSliderTable<5248>(kBishopMagics, kBishopSteps);
+constexpr LineTable g_lines = MakeLineTable();
+constexpr LeaperTable g_leapers = MakeLeaperTable();
+
+// Kogge-Stone fills move along four rays at once. Rays towards higher bits
+// shift left and the rest shift right; a lane's unused shift is by 64, which
+// leaves nothing. Moving one file over can wrap around to the far edge, so
+// each ray masks off the file it would wrap onto.
+struct Rays {
+  uint64_t left[4];
+  uint64_t right[4];
+  uint64_t mask[4];
+};
+
+static constexpr uint64_t kNotFileA = ~kFileA;
+static constexpr uint64_t kNotFileH = ~(kFileA << (kRow - 1));
+
+static constexpr Rays kRookRays = {
+  {8, 64, 1, 64},  // Up, down, right, left.
+  {64, 8, 64, 1},
+  {~0ull, ~0ull, kNotFileA, kNotFileH},
+};
+
+static constexpr Rays kBishopRays = {
+  {9, 7, 64, 64},  // Up right, up left, down left, down right.
+  {64, 64, 9, 7},
+  {kNotFileA, kNotFileH, kNotFileH, kNotFileA},
+};
+
+static inline uint64_t Shift(uint64_t x, uint64_t left, uint64_t right) {
+  return (left < 64) ? x << left : x >> right;
+}
+
+// One ray at a time, for CPUs without AVX2.
+static uint64_t KoggeStoneScalar(Square square, Bitboard occupied,
+                                 const Rays& rays) {
+  uint64_t res = 0;
+  for (int ray = 0; ray < 4; ++ray) {
+    uint64_t left = rays.left[ray];
+    uint64_t right = rays.right[ray];
+    uint64_t fill = Bitboard(square).bits();
+    uint64_t empty = ~occupied.bits() & rays.mask[ray];
+    for (uint64_t step = 1; step <= 4; step *= 2) {
+      fill |= empty & Shift(fill, left * step, right * step);
+      empty &= Shift(empty, left * step, right * step);
+    }
+    res |= Shift(fill, left, right) & rays.mask[ray];
+  }
+  return res;
+}
+
+#ifdef CHESSY_X86
+
+__attribute__((target("avx2")))
+static inline __m256i Shift(__m256i x, __m256i left, __m256i right) {
+  return _mm256_or_si256(_mm256_sllv_epi64(x, left),
+                         _mm256_srlv_epi64(x, right));
+}
+
+// Fills the slider's bit through empty squares in doubling steps of 1, 2
+// and 4, then shifts once more to land on the first blocker in each ray.
+__attribute__((target("avx2")))
+static uint64_t KoggeStoneAvx2(Square square, Bitboard occupied,
+                               const Rays& rays) {
+  __m256i left = _mm256_loadu_si256((const __m256i*)rays.left);
+  __m256i right = _mm256_loadu_si256((const __m256i*)rays.right);
+  __m256i mask = _mm256_loadu_si256((const __m256i*)rays.mask);
+  __m256i fill = _mm256_set1_epi64x(Bitboard(square).bits());
+  __m256i empty = _mm256_and_si256(_mm256_set1_epi64x(~occupied.bits()),
+                                   mask);
+  __m256i far_left = left;
+  __m256i far_right = right;
+  for (int step = 0; step < 3; ++step) {
+    fill = _mm256_or_si256(
+        fill, _mm256_and_si256(empty, Shift(fill, far_left, far_right)));
+    empty = _mm256_and_si256(empty, Shift(empty, far_left, far_right));
+    far_left = _mm256_add_epi64(far_left, far_left);
+    far_right = _mm256_add_epi64(far_right, far_right);
+  }
+  __m256i attacks = _mm256_and_si256(Shift(fill, left, right), mask);
+  __m128i half = _mm_or_si128(_mm256_castsi256_si128(attacks),
+                              _mm256_extracti128_si256(attacks, 1));
+  return _mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1);
+}
+
+static const bool g_kogge_stone_avx2 = HasAvx2();
+
+static inline uint64_t KoggeStone(Square square, Bitboard occupied,
+                                  const Rays& rays) {
+  return (g_kogge_stone_avx2 ?
+          KoggeStoneAvx2(square, occupied, rays) :
+          KoggeStoneScalar(square, occupied, rays));
+}
+
+__attribute__((target("bmi2")))
+Bitboard PextRookAttacks(Square square, Bitboard occupied) {
+  const Magic& m = g_rook_table.magics[square.index()];
+  return Bitboard(g_rook_table.pext[m.offset +
+                                    _pext_u64(occupied.bits(), m.mask)]);
+}
+
+__attribute__((target("bmi2")))
+Bitboard PextBishopAttacks(Square square, Bitboard occupied) {
+  const Magic& m = g_bishop_table.magics[square.index()];
+  return Bitboard(g_bishop_table.pext[m.offset +
+                                      _pext_u64(occupied.bits(), m.mask)]);
+}
+
+#else
+
+static inline uint64_t KoggeStone(Square square, Bitboard occupied,
+                                  const Rays& rays) {
+  return KoggeStoneScalar(square, occupied, rays);
+}
+
+Bitboard PextRookAttacks(Square square, Bitboard occupied) {
+  return MagicRookAttacks(square, occupied);
+}
+
+Bitboard PextBishopAttacks(Square square, Bitboard occupied) {
+  return MagicBishopAttacks(square, occupied);
+}
+
+#endif  // CHESSY_X86
+
+Bitboard KoggeStoneRookAttacks(Square square, Bitboard occupied) {
+  return Bitboard(KoggeStone(square, occupied, kRookRays));
+}
+
+Bitboard KoggeStoneBishopAttacks(Square square, Bitboard occupied) {
+  return Bitboard(KoggeStone(square, occupied, kBishopRays));
+}
+
+bool IsSupported(SliderBackend backend) {
+  return backend != kPextSliders || HasBmi2();
+}
+
+SliderBackend BestSliderBackend() {
+  return HasFastPext() ? kPextSliders : kMagicSliders;
+}
+
+const char* SliderBackendName(SliderBackend backend) {
+  switch (backend) {
+    case kPextSliders:       return "pext";
+    case kKoggeStoneSliders: return "kogge-stone";
+    default:                 return "magic";
+  }
+}
+
+}  // namespace chessy
@@ -0,0 +1,177 @@
+// attacks.h - attack tables, built by the compiler
+
+#ifndef CHESSY_ATTACKS_H_
+#define CHESSY_ATTACKS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bitboard.h"
+#include "piece.h"
+#include "square.h"
+
+namespace chessy {
+
+// Single steps each kind of piece can take, as {rank, file} offsets. Pawns
+// capture along the first two bishop steps if white, or the last two if
+// black.
+constexpr int kRookSteps[4][2] = {{1, 0}, {-1, 0}, {0, -1}, {0, 1}};
+constexpr int kBishopSteps[4][2] = {{1, -1}, {1, 1}, {-1, -1}, {-1, 1}};
+constexpr int kKnightSteps[8][2] = {
+  {2, -1}, {2, 1}, {-2, -1}, {-2, 1}, {-1, -2}, {1, -2}, {-1, 2}, {1, 2},
+};
+constexpr int kKingSteps[8][2] = {
+  {1, 0}, {-1, 0}, {0, -1}, {0, 1}, {1, -1}, {1, 1}, {-1, -1}, {-1, 1},
+};
+
+// Squares are numbered rank * 8 + file in tables, same as bitboard bits.
+constexpr bool OnBoard(int rank, int file) {
+  return 0 <= rank && rank < kRow && 0 <= file && file < kRow;
+}
+
+// A magic maps every blocker configuration along a slider's rays to a slot in
+// a shared attack table: only the relevant occupancy bits are kept by |mask|,
+// multiplying by |magic| gathers them into the top bits, and the shift turns
+// that into an index. One multiply, shift and load replaces a ray walk.
+struct Magic {
+  uint64_t mask;    // Relevant occupancy (rays without edges).
+  uint64_t magic;
+  uint32_t offset;  // First slot of this square's attack table.
+  int shift;
+
+  constexpr inline size_t Index(uint64_t occupied) const {
+    return offset + (((occupied & mask) * magic) >> shift);
+  }
+};
+
+template <size_t N>
+struct SliderTable {
+  Magic magics[64];
+  uint64_t attacks[N];  // Sum over all squares of 2^popcount(mask).
+  uint64_t pext[N];     // Same again, indexed by offset + PEXT(mask).
+};
+
+struct LineTable {
+  uint64_t between[64][64];
+  uint64_t line[64][64];
+};
+
+struct LeaperTable {
+  uint64_t knight[64];
+  uint64_t king[64];
+  uint64_t pawn[kColors][64];
+  uint8_t deltas[240];  // See MightAttack().
+};
+
+// All of these are constexpr in attacks.cc, so they're computed during the
+// build and land in read-only data. There's nothing to initialize at startup.
+extern const SliderTable<102400> g_rook_table;
+extern const SliderTable<5248> g_bishop_table;
+extern const LineTable g_lines;
+extern const LeaperTable g_leapers;
+
+// Where slider attacks come from. Magic lookups are a multiply and a load
+// from 840 KiB of attacks[] tables, which is fast while they stay in cache.
+// BMI2's PEXT gathers the index in one instruction instead of the multiply,
+// but loads from its own pext[] copy of the same size, so the two slider
+// tables come to about 1.7 MB. Kogge-Stone fills touch no memory at all:
+// they smear the slider along all four of a piece's rays at once, one ray per
+// AVX2 lane if the CPU has it, or one after another otherwise. Which one wins
+// depends on the host, so bench measures them.
+enum SliderBackend {
+  kMagicSliders,
+  kPextSliders,
+  kKoggeStoneSliders,
+};
+
+extern SliderBackend g_slider_backend;  // Set by InitBitmoves().
+
+bool IsSupported(SliderBackend backend);  // Can this CPU run it?
+SliderBackend BestSliderBackend();  // PEXT where it's fast, else magic.
+const char* SliderBackendName(SliderBackend backend);
+
+// Only call these if IsSupported(kPextSliders).
+Bitboard PextRookAttacks(Square square, Bitboard occupied);
+Bitboard PextBishopAttacks(Square square, Bitboard occupied);
+
+Bitboard KoggeStoneRookAttacks(Square square, Bitboard occupied);
+Bitboard KoggeStoneBishopAttacks(Square square, Bitboard occupied);
+
+inline Bitboard MagicRookAttacks(Square square, Bitboard occupied) {
+  const Magic& m = g_rook_table.magics[square.index()];
+  return Bitboard(g_rook_table.attacks[m.Index(occupied.bits())]);
+}
+
+inline Bitboard MagicBishopAttacks(Square square, Bitboard occupied) {
+  const Magic& m = g_bishop_table.magics[square.index()];
+  return Bitboard(g_bishop_table.attacks[m.Index(occupied.bits())]);
+}
+
+// Squares a slider on |square| attacks given all pieces in |occupied|. The
+// first blocker in each direction is included, whatever its color.
+inline Bitboard RookAttacks(Square square, Bitboard occupied) {
+  switch (g_slider_backend) {
+    case kPextSliders:       return PextRookAttacks(square, occupied);
+    case kKoggeStoneSliders: return KoggeStoneRookAttacks(square, occupied);
+    default:                 return MagicRookAttacks(square, occupied);
+  }
+}
+
+inline Bitboard BishopAttacks(Square square, Bitboard occupied) {
+  switch (g_slider_backend) {
+    case kPextSliders:       return PextBishopAttacks(square, occupied);
+    case kKoggeStoneSliders: return KoggeStoneBishopAttacks(square, occupied);
+    default:                 return MagicBishopAttacks(square, occupied);
+  }
+}
+
+inline Bitboard QueenAttacks(Square square, Bitboard occupied) {
+  return RookAttacks(square, occupied) | BishopAttacks(square, occupied);
+}
+
+// Returns attacks for kBishop, kRook or kQueen; anything else is empty.
+inline Bitboard SliderAttacks(Pieces piece, Square square, Bitboard occupied) {
+  switch (piece) {
+    case kBishop: return BishopAttacks(square, occupied);
+    case kRook:   return RookAttacks(square, occupied);
+    case kQueen:  return QueenAttacks(square, occupied);
+    default:      return Bitboard();
+  }
+}
+
+// Squares strictly between |a| and |b| if they share a rank, file or
+// diagonal, otherwise empty.
+inline Bitboard Between(Square a, Square b) {
+  return Bitboard(g_lines.between[a.index()][b.index()]);
+}
+
+// The whole rank, file or diagonal through |a| and |b|, edge to edge, or
+// empty if they aren't aligned. A pinned piece must stay on this line.
+inline Bitboard Line(Square a, Square b) {
+  return Bitboard(g_lines.line[a.index()][b.index()]);
+}
+
+inline Bitboard KnightAttacks(Square square) {
+  return Bitboard(g_leapers.knight[square.index()]);
+}
+
+inline Bitboard KingAttacks(Square square) {
+  return Bitboard(g_leapers.king[square.index()]);
+}
+
+// Squares a |color| pawn on |square| could capture on.
+inline Bitboard PawnAttacks(Colors color, Square square) {
+  return Bitboard(g_leapers.pawn[color][square.index()]);
+}
+
+// Could |piece| on |source| attack |dest| if nothing were in the way? The
+// difference of two 0x88 squares says how they're aligned no matter where
+// they are on the board, so one 240-entry table answers for every pair.
+// Pawns aren't included since their direction depends on color.
+inline bool MightAttack(Pieces piece, Square source, Square dest) {
+  return g_leapers.deltas[dest.x88() - source.x88() + 119] & (1 << piece);
+}
+
+}  // namespace chessy
+
+#endif  // CHESSY_ATTACKS_H_
@@ -0,0 +1,84 @@
+#include "attacks.h"
+#include "bitboard.h"
+#include "square.h"
+#include <cstdlib>
+#include <gtest/gtest.h>
+
+using namespace chessy;
+
+// Every slider backend must give the same attacks for any occupancy.
+TEST(AttacksTest, BackendsAgree) {
+  std::srand(13);
+  for (int trial = 0; trial < 2000; ++trial) {
+    // Sparse and dense boards both, by ANDing a varying number of words.
+    uint64_t bits = ~0ull;
+    for (int n = trial % 4; n >= 0; --n) {
+      bits &= ((uint64_t)std::rand() << 40) ^ ((uint64_t)std::rand() << 20) ^
+              std::rand();
+    }
+    Bitboard occupied(bits);
+    for (int index = 0; index < 64; ++index) {
+      Square square(index / kRow, index % kRow);
+      ASSERT_EQ(MagicRookAttacks(square, occupied).bits(),
+                KoggeStoneRookAttacks(square, occupied).bits())
+          << square << "\n" << occupied;
+      ASSERT_EQ(MagicBishopAttacks(square, occupied).bits(),
+                KoggeStoneBishopAttacks(square, occupied).bits())
+          << square << "\n" << occupied;
+      if (!IsSupported(kPextSliders))
+        continue;
+      ASSERT_EQ(MagicRookAttacks(square, occupied).bits(),
+                PextRookAttacks(square, occupied).bits())
+          << square << "\n" << occupied;
+      ASSERT_EQ(MagicBishopAttacks(square, occupied).bits(),
+                PextBishopAttacks(square, occupied).bits())
+          << square << "\n" << occupied;
+    }
+  }
+}
+
+TEST(AttacksTest, RookStopsAtFirstBlocker) {
+  Bitboard occupied = Bitboard(Square("a3")) | Bitboard(Square("a5")) |
+                      Bitboard(Square("d1"));
+  Bitboard expected = Bitboard(Square("a2")) | Bitboard(Square("a3")) |
+                      Bitboard(Square("b1")) | Bitboard(Square("c1")) |
+                      Bitboard(Square("d1"));
+  EXPECT_EQ(expected.bits(), RookAttacks(Square("a1"), occupied).bits());
+}
+
+TEST(AttacksTest, BishopOnEmptyBoard) {
+  Bitboard expected = Bitboard(Square("a1")) | Bitboard(Square("b2")) |
+                      Bitboard(Square("c3")) | Bitboard(Square("e5")) |
+                      Bitboard(Square("f6")) | Bitboard(Square("g7")) |
+                      Bitboard(Square("h8")) | Bitboard(Square("a7")) |
+                      Bitboard(Square("b6")) | Bitboard(Square("c5")) |
+                      Bitboard(Square("e3")) | Bitboard(Square("f2")) |
+                      Bitboard(Square("g1"));
+  EXPECT_EQ(expected.bits(), BishopAttacks(Square("d4"), Bitboard()).bits());
+}
+
+TEST(AttacksTest, Between) {
+  EXPECT_EQ((Bitboard(Square("b2")) | Bitboard(Square("c3"))).bits(),
+            Between(Square("a1"), Square("d4")).bits());
+  EXPECT_FALSE(Between(Square("a1"), Square("b3")));
+  EXPECT_FALSE(Between(Square("a1"), Square("a2")));
+}
+
+TEST(AttacksTest, MightAttack) {
+  EXPECT_TRUE(MightAttack(kRook, Square("a1"), Square("a8")));
+  EXPECT_FALSE(MightAttack(kRook, Square("a1"), Square("b8")));
+  EXPECT_TRUE(MightAttack(kQueen, Square("h8"), Square("a1")));
+  EXPECT_FALSE(MightAttack(kBishop, Square("h8"), Square("h1")));
+  EXPECT_TRUE(MightAttack(kKnight, Square("g1"), Square("f3")));
+  EXPECT_FALSE(MightAttack(kKnight, Square("h1"), Square("a2")));  // Wraps.
+  EXPECT_TRUE(MightAttack(kKing, Square("e1"), Square("d2")));
+  EXPECT_FALSE(MightAttack(kKing, Square("e1"), Square("e1")));
+}
+
+TEST(AttacksTest, Line) {
+  Bitboard diagonal = Bitboard(0x8040201008040201ull);
+  EXPECT_EQ(diagonal.bits(), Line(Square("c3"), Square("f6")).bits());
+  EXPECT_EQ(diagonal.bits(), Line(Square("h8"), Square("a1")).bits());
+  EXPECT_EQ(0xffull, Line(Square("b1"), Square("c1")).bits());
+  EXPECT_FALSE(Line(Square("a1"), Square("b3")));
+}
@@ -0,0 +1,209 @@
+// bench.cc - microbenchmarks for chessy's hot paths
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "attacks.h"
+#include "bitmove.h"
+#include "board.h"
+#include "cpu.h"
+#include "random_games.h"
+
+using namespace chessy;
+
+DEFINE_int32(games, 50, "Random games to draw benchmark positions from.");
+DEFINE_int32(plies, 80, "Maximum plies per random game.");
+DEFINE_int32(reps, 20, "Times each position is measured.");
+DEFINE_int32(evict_mb, 32, "Bytes written between cold lookups, in MB.");
+
+typedef std::chrono::steady_clock Clock;
+
+static double Nanos(Clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+// Visiting a child: copy-construct it versus play and take back the move in
+// place. Both read the score so neither can be optimized away.
+static void BenchChildren() {
+  Clock::duration copy_time(0);
+  Clock::duration make_time(0);
+  long children = 0;
+  long sink = 0;
+  std::srand(1);
+  ForEachRandomPosition(FLAGS_games, FLAGS_plies,
+                        [&](Board* board, const MoveList& moves) {
+    Clock::time_point start = Clock::now();
+    for (int rep = 0; rep < FLAGS_reps; ++rep) {
+      for (const Bitmove& move : moves) {
+        Board child(*board, move);
+        sink += child.score();
+      }
+    }
+    copy_time += Clock::now() - start;
+    start = Clock::now();
+    for (int rep = 0; rep < FLAGS_reps; ++rep) {
+      for (const Bitmove& move : moves) {
+        Board::Undo undo;
+        board->MakeMove(move, &undo);
+        sink += board->score();
+        board->UnmakeMove(move, undo);
+      }
+    }
+    make_time += Clock::now() - start;
+    children += moves.size() * FLAGS_reps;
+  });
+  printf("children visited:  %ld (sink %ld)\n", children, sink);
+  printf("copy-construct:    %6.2f ns/child\n", Nanos(copy_time) / children);
+  printf("make/unmake:       %6.2f ns/child\n", Nanos(make_time) / children);
+}
+
+// Exact identity of a position, to tell real transpositions from collisions.
+static std::string Describe(const Board& board) {
+  std::string res(1, static_cast<char>(board.color()));
+  for (int rank = 0; rank < kRow; ++rank) {
+    for (int file = 0; file < kRow; ++file) {
+      res += static_cast<char>(board.GetPiece(Square(rank, file)).bits());
+    }
+  }
+  return res;
+}
+
+static uint64_t Occupancy(const Board& board) {
+  uint64_t res = 0;
+  for (int rank = 0; rank < kRow; ++rank) {
+    for (int file = 0; file < kRow; ++file) {
+      if (!board.GetPiece(Square(rank, file)).IsEmpty()) {
+        res |= Bitboard(rank, file).bits();
+      }
+    }
+  }
+  return res;
+}
+
+// Counts keys shared by different positions, for the Zobrist key and for the
+// occupancy mask it replaced. The positions are every node of random games
+// plus all their children.
+static void BenchHashCollisions() {
+  typedef std::unordered_map<uint64_t, std::string> Seen;
+  Seen zobrist;
+  Seen occupancy;
+  std::unordered_set<std::string> positions;
+  long zobrist_collisions = 0;
+  long occupancy_collisions = 0;
+  auto visit = [&](const Board& board) {
+    std::string desc = Describe(board);
+    if (!positions.insert(desc).second)
+      return;
+    auto z = zobrist.insert(Seen::value_type(board.Hash(), desc));
+    zobrist_collisions += !z.second;
+    auto o = occupancy.insert(Seen::value_type(Occupancy(board), desc));
+    occupancy_collisions += !o.second;
+  };
+  std::srand(2);
+  ForEachRandomPosition(FLAGS_games, FLAGS_plies,
+                        [&](Board* board, const MoveList& moves) {
+    visit(*board);
+    for (const Bitmove& move : moves) {
+      Board::Undo undo;
+      board->MakeMove(move, &undo);
+      visit(*board);
+      board->UnmakeMove(move, undo);
+    }
+  });
+  printf("distinct positions: %zu\n", positions.size());
+  printf("zobrist collisions:   %ld (%.4f%%)\n", zobrist_collisions,
+         100.0 * zobrist_collisions / positions.size());
+  printf("occupancy collisions: %ld (%.4f%%)\n", occupancy_collisions,
+         100.0 * occupancy_collisions / positions.size());
+}
+
+struct SliderSample {
+  Square square;
+  Bitboard occupied;
+};
+
+// Times queen attacks, both slider kinds at once, over every sample. Cold
+// runs scribble over a buffer bigger than the caches before each batch, like
+// a search thread whose cache has been taken over by its neighbours.
+template <typename Rook, typename Bishop>
+static double SliderNanos(const std::vector<SliderSample>& samples,
+                          Rook rook, Bishop bishop, bool cold,
+                          std::vector<char>* evict, long* sink) {
+  const size_t kBatch = 64;
+  Clock::duration time(0);
+  int reps = cold ? 1 : FLAGS_reps;
+  for (int rep = 0; rep < reps; ++rep) {
+    for (size_t begin = 0; begin < samples.size(); begin += kBatch) {
+      if (cold) {
+        for (size_t n = 0; n < evict->size(); n += 64) {
+          (*evict)[n] += 1;
+        }
+      }
+      size_t end = std::min(begin + kBatch, samples.size());
+      Clock::time_point start = Clock::now();
+      for (size_t n = begin; n < end; ++n) {
+        const SliderSample& sample = samples[n];
+        *sink += (rook(sample.square, sample.occupied) |
+                  bishop(sample.square, sample.occupied)).bits() >> 60;
+      }
+      time += Clock::now() - start;
+    }
+  }
+  return Nanos(time) / (samples.size() * reps);
+}
+
+// Magic tables, PEXT tables and Kogge-Stone fills, on the squares and
+// occupancies sliders actually see in random games.
+static void BenchSliders() {
+  std::vector<SliderSample> samples;
+  std::srand(3);
+  ForEachRandomPosition(FLAGS_games, FLAGS_plies,
+                        [&samples](Board* board, const MoveList&) {
+    Bitboard occupied = board->pieces(kWhite) | board->pieces(kBlack);
+    for (int color = 0; color < kColors; ++color) {
+      for (int piece = kBishop; piece <= kQueen; ++piece) {
+        for (Bitboard sliders = board->pieces((Colors)color, (Pieces)piece);
+             sliders;) {
+          samples.push_back({sliders.PopSquare(), occupied});
+        }
+      }
+    }
+  });
+  std::vector<char> evict(static_cast<size_t>(FLAGS_evict_mb) << 20);
+  long sink = 0;
+  for (bool cold : {false, true}) {
+    double magic = SliderNanos(samples, MagicRookAttacks, MagicBishopAttacks,
+                               cold, &evict, &sink);
+    double kogge = SliderNanos(samples, KoggeStoneRookAttacks,
+                               KoggeStoneBishopAttacks, cold, &evict, &sink);
+    printf("%s slider lookups: %zu (sink %ld)\n", cold ? "cold" : "hot",
+           samples.size(), sink);
+    printf("  magic:           %6.2f ns/queen\n", magic);
+    if (IsSupported(kPextSliders)) {
+      double pext = SliderNanos(samples, PextRookAttacks, PextBishopAttacks,
+                                cold, &evict, &sink);
+      printf("  pext:            %6.2f ns/queen\n", pext);
+    }
+    printf("  kogge-stone:     %6.2f ns/queen\n", kogge);
+  }
+}
+
+int main(int argc, char** argv) {
+  google::SetUsageMessage("bench [FLAGS]");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  InitBitmoves();
+  printf("cpu: %s\n", CpuFeatures().c_str());
+  BenchChildren();
+  BenchHashCollisions();
+  BenchSliders();
+  return 0;
+}
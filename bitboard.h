@@ -24,6 +24,17 @@ class Bitboard {
   constexpr inline uint64_t bits() const { return bits_;      }
   std::string ToString();
 
+  // Removes the lowest set bit and returns its square. Must not be empty.
+  inline Square PopSquare() {
+    int index = __builtin_ctzll(bits_);
+    bits_ &= bits_ - 1;
+    return Square(index / kRow, index % kRow);
+  }
+
+  inline Bitboard operator~() const {
+    return Bitboard(~bits_);
+  }
+
   inline Bitboard operator|(const Bitboard& other) const {
     return Bitboard(bits_ | other.bits_);
   }
@@ -52,6 +63,32 @@ class Bitboard {
   uint64_t bits_;
 };
 
+// The a-file and first rank. Shift by file or by 8 * rank for the others.
+constexpr uint64_t kFileA = 0x0101010101010101ull;
+constexpr uint64_t kRank1 = 0x00000000000000ffull;
+
+constexpr inline Bitboard RankMask(int rank) {
+  return Bitboard(kRank1 << (rank * kRow));
+}
+
+// Moves every piece on the board one square over at once. Bits that would
+// fall off an edge, or wrap around to the far file, are dropped.
+constexpr inline Bitboard ShiftUp(Bitboard board) {
+  return Bitboard(board.bits() << kRow);
+}
+
+constexpr inline Bitboard ShiftDown(Bitboard board) {
+  return Bitboard(board.bits() >> kRow);
+}
+
+constexpr inline Bitboard ShiftLeft(Bitboard board) {
+  return Bitboard((board.bits() >> 1) & ~(kFileA << (kRow - 1)));
+}
+
+constexpr inline Bitboard ShiftRight(Bitboard board) {
+  return Bitboard((board.bits() << 1) & ~kFileA);
+}
+
 std::ostream& operator<<(std::ostream& os, Bitboard board);
 
 }  // namespace chessy
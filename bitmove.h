@@ -1,51 +1,152 @@
-// bitboard.h
+// bitmove.h
 
 #ifndef CHESSY_BITMOVE_H_
 #define CHESSY_BITMOVE_H_
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "attacks.h"
 #include "bitboard.h"
 #include "piece.h"
 #include "square.h"
 
 namespace chessy {
 
-struct Bitmove;
-
-typedef std::vector<Bitmove> Bitmoves;
+// What kind of move a Bitmove is, stored in its top two bits.
+enum MoveType {
+  kNormalMove = 0,
+  kPromotion  = 1,
+  kEnPassant  = 2,
+  kCastling   = 3,
+};
 
-struct Bitmove {
+// A move packed into 16 bits: source square index in bits 0-5, dest square
+// index in bits 6-11, the promotion piece (less kKnight) in bits 12-13 and
+// the MoveType in bits 14-15. Zero would be a1->a1, which is never a move, so
+// it doubles as "no move" in tables. Everything else is worked out on demand.
+class Bitmove {
  public:
   static const Bitmove kInvalid;
-  Bitmove()
-      : source(Square::kInvalid),
-        dest(Square::kInvalid) {}
-  explicit Bitmove(Square source)
-      : source(source),
-        dest(source),
-        source_bit(Bitboard(source)) {}
-  Bitmove(Square source, Square dest, Bitboard path)
-      : source(source),
-        dest(dest),
-        path(path),
-        source_bit(Bitboard(source)),
-        dest_bit(Bitboard(dest)) {}
-  inline bool IsValid() const { return source.IsValid() && dest.IsValid(); }
+  constexpr Bitmove() : bits_(0) {}
+  constexpr explicit Bitmove(uint16_t bits) : bits_(bits) {}
+  constexpr Bitmove(Square source, Square dest,
+                    MoveType type = kNormalMove, Pieces promotion = kKnight)
+      : bits_(source.index() | dest.index() << 6 |
+              (promotion - kKnight) << 12 | type << 14) {}
+
+  constexpr inline uint16_t bits() const { return bits_; }
+  constexpr inline int from_to() const { return bits_ & 0xfff; }
+  constexpr inline Square source() const {
+    return Square((bits_ >> 3) & 7, bits_ & 7);
+  }
+  constexpr inline Square dest() const {
+    return Square((bits_ >> 9) & 7, (bits_ >> 6) & 7);
+  }
+  constexpr inline MoveType type() const {
+    return static_cast<MoveType>(bits_ >> 14);
+  }
+  constexpr inline Pieces promotion() const {  // Only if type is kPromotion.
+    return static_cast<Pieces>(((bits_ >> 12) & 3) + kKnight);
+  }
+  constexpr inline bool IsValid() const {
+    return (bits_ & 63) != ((bits_ >> 6) & 63);
+  }
+
+  inline Bitboard source_bit() const {
+    return Bitboard(1ull << (bits_ & 63));
+  }
+  inline Bitboard dest_bit() const {
+    return Bitboard(1ull << ((bits_ >> 6) & 63));
+  }
+  // Squares that must not hold a friend, ending with dest. All but dest must
+  // also be empty.
+  inline Bitboard path() const {
+    return Between(source(), dest()) | dest_bit();
+  }
+
+  constexpr inline bool operator==(Bitmove other) const {
+    return bits_ == other.bits_;
+  }
+  constexpr inline bool operator!=(Bitmove other) const {
+    return bits_ != other.bits_;
+  }
+
   std::string ToString() const;
-  Square source;
-  Square dest;
-  Bitboard path;
-  Bitboard source_bit;
-  Bitboard dest_bit;
+
+ private:
+  uint16_t bits_;
+};
+
+static_assert(sizeof(Bitmove) == 2, "moves must pack into 16 bits");
+
+// No position has more legal moves than this.
+const int kMaxMoves = 256;
+
+// Room for kMaxMoves moves, left uninitialized. Generators fill it before
+// anything reads it, and Bitmove() would otherwise run on all 256 slots at
+// every node.
+class MoveBuffer {
+ public:
+  MoveBuffer() {}
+  MoveBuffer(const MoveBuffer&) = delete;
+  MoveBuffer& operator=(const MoveBuffer&) = delete;
+
+  inline Bitmove* data() { return moves_; }
+  inline const Bitmove* data() const { return moves_; }
+  inline Bitmove& operator[](size_t n) { return moves_[n]; }
+  inline const Bitmove& operator[](size_t n) const { return moves_[n]; }
+
+ private:
+  union {
+    Bitmove moves_[kMaxMoves];
+  };
+};
+
+// A list of moves that lives on the stack. Search creates one or more per
+// node, so it must never touch the heap.
+class MoveList {
+ public:
+  MoveList() : size_(0) {}
+  MoveList(const MoveList& other) : size_(other.size_) {
+    std::copy(other.begin(), other.end(), begin());
+  }
+  MoveList& operator=(const MoveList& other) {
+    size_ = other.size_;
+    std::copy(other.begin(), other.end(), begin());
+    return *this;
+  }
+
+  inline void push_back(const Bitmove& move) { moves_[size_++] = move; }
+  inline void resize(size_t size) { size_ = size; }  // Must be <= kMaxMoves.
+  inline void clear() { size_ = 0; }
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0; }
+  inline Bitmove* data() { return moves_.data(); }
+  inline Bitmove* begin() { return moves_.data(); }
+  inline Bitmove* end() { return moves_.data() + size_; }
+  inline const Bitmove* begin() const { return moves_.data(); }
+  inline const Bitmove* end() const { return moves_.data() + size_; }
+  inline Bitmove& front() { return moves_[0]; }
+  inline const Bitmove& front() const { return moves_[0]; }
+  inline Bitmove& operator[](size_t n) { return moves_[n]; }
+  inline const Bitmove& operator[](size_t n) const { return moves_[n]; }
+
+ private:
+  size_t size_;
+  MoveBuffer moves_;
 };
 
-void InitBitmoves();  // Generate table of all possible moves.
-const Bitmove& GetBitmove(Piece piece, Square source, Square dest);
-const Bitmoves& GetBitmoves(Piece piece, Square source);
-const Bitboard& GetBitmovesMask(Piece piece, Square source);
+// Sets up what the compile-time tables leave, including which way slider
+// attacks are worked out.
+void InitBitmoves(SliderBackend sliders = BestSliderBackend());
+
+// The move if |piece| could go from |source| to |dest| on an empty board,
+// otherwise Bitmove::kInvalid.
+Bitmove GetBitmove(Piece piece, Square source, Square dest);
 std::ostream& operator<<(std::ostream& os, const Bitmove& move);
 
 }  // namespace chessy
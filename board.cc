@@ -2,49 +2,378 @@
 
 #include "board.h"
 
+#include <cctype>
 #include <cstring>
 #include <algorithm>
+#include <sstream>
 
 #include <glog/logging.h>
 
+#include "attacks.h"
+#include "zobrist.h"
+
 namespace chessy {
 
+// Piece letters in FEN, lowercase, at the index of their Pieces value.
+static const char kFenPieces[] = " pnbrqk";
+
+// Castling letters in FEN at the index of their bit in Castling.
+static const char kFenCastling[] = "KQkq";
+
+// Castling rights that survive a move from or to each square, indexed by
+// square index. Moving a king or rook, or taking a rook, spoils them.
+static const uint8_t kCastlingKept[64] = {
+  13, 15, 15, 15, 12, 15, 15, 14,  // a1 e1 h1
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+   7, 15, 15, 15,  3, 15, 15, 11,  // a8 e8 h8
+};
+
+// Castling moves are encoded as the king's move. This finds the rook's.
+static inline void CastlingRook(Bitmove move, Square* source, Square* dest) {
+  int rank = move.dest().rank();
+  bool kingside = move.dest().file() == 6;
+  *source = Square(rank, kingside ? 7 : 0);
+  *dest = Square(rank, kingside ? 5 : 3);
+}
+
+// The pawn taken en passant sits beside the capturer, not on dest.
+static inline Square EnPassantVictim(Bitmove move) {
+  return Square(move.source().rank(), move.dest().file());
+}
+
+// Rank |rank| as seen from |color|'s side, so 0 is always its back rank.
+// With a constant color this folds away at compile time.
+static constexpr int RelativeRank(Colors color, int rank) {
+  return (color == kWhite) ? rank : kRow - 1 - rank;
+}
+
 Board::Board() : color_(kWhite),
-                 friends_(kInitialFriends),
-                 enemies_(kInitialEnemies) {
+                 castling_(kAllCastling),
+                 en_passant_(Square::kInvalid) {
   memcpy(reinterpret_cast<void *>(squares_),
          reinterpret_cast<const void *>(kInitialSquares),
          sizeof(squares_));
+  for (int rank = 0; rank < kRow; ++rank) {
+    for (int file = 0; file < kRow; ++file) {
+      Piece piece = squares_[Square(rank, file)];
+      if (!piece.IsEmpty()) {
+        colors_[piece.color()] |= Bitboard(rank, file);
+        pieces_[piece.color()][piece.piece()] |= Bitboard(rank, file);
+      }
+    }
+  }
+  kings_[kWhite] = Square(0, 4);
+  kings_[kBlack] = Square(7, 4);
+  lost_[kWhite] = 0;
+  lost_[kBlack] = 0;
+  hash_ = ComputeHash();
+  UpdateCheckInfo();
 }
 
-Board::Board(const Board& old, const Bitmove& move) {
+Board::Board(const Board& old, Bitmove move) {
   memcpy((void*)this, (void*)&old, sizeof(Board));
-  Piece source_tile = squares_[move.source];
-  Piece dest_tile = squares_[move.dest];
-  DCHECK(move.source.IsValid()) << move;
-  DCHECK(move.dest.IsValid()) << move;
+  Undo undo;
+  MakeMove(move, &undo);
+}
+
+bool Board::LoadFen(const std::string& fen) {
+  std::istringstream fields(fen);
+  std::string placement, color, castling, en_passant;
+  if (!(fields >> placement >> color >> castling >> en_passant))
+    return false;
+  // The move counters may follow, but nothing here needs them.
+  memset(reinterpret_cast<void *>(squares_), 0, sizeof(squares_));
+  memset(reinterpret_cast<void *>(colors_), 0, sizeof(colors_));
+  memset(reinterpret_cast<void *>(pieces_), 0, sizeof(pieces_));
+  int rank = kRow - 1;
+  int file = 0;
+  for (char c : placement) {
+    if (c == '/') {
+      if (file != kRow || --rank < 0)
+        return false;
+      file = 0;
+    } else if ('1' <= c && c <= '8') {
+      file += c - '0';
+    } else {
+      const char* kinds = strchr(kFenPieces, tolower(c));
+      if (!kinds || kinds == kFenPieces || !*kinds || file >= kRow)
+        return false;
+      Piece piece(isupper(c) ? kWhite : kBlack,
+                  static_cast<Pieces>(kinds - kFenPieces));
+      squares_[Square(rank, file)] = piece;
+      colors_[piece.color()] |= Bitboard(rank, file);
+      pieces_[piece.color()][piece.piece()] |= Bitboard(rank, file);
+      ++file;
+    }
+    if (file > kRow)
+      return false;
+  }
+  if (rank != 0 || file != kRow)
+    return false;
+  if (color != "w" && color != "b")
+    return false;
+  color_ = (color == "w") ? kWhite : kBlack;
+  // Material is scored by what each side has lost since the opening.
+  int initial = 0;
+  for (int n = 0; n < kRow; ++n) {
+    initial += kInitialSquares[Square(0, n)].value() +
+               kInitialSquares[Square(1, n)].value();
+  }
+  for (int c = 0; c < kColors; ++c) {
+    Bitboard kings = pieces_[c][kKing];
+    if (!kings || (kings.bits() & (kings.bits() - 1)))
+      return false;
+    kings_[c] = kings.PopSquare();
+    lost_[c] = initial;
+    for (int piece = kPawn; piece <= kKing; ++piece) {
+      for (Bitboard b = pieces_[c][piece]; b; b.PopSquare()) {
+        lost_[c] -= Piece((Colors)c, (Pieces)piece).value();
+      }
+    }
+  }
+  castling_ = 0;
+  if (castling != "-") {
+    for (char c : castling) {
+      const char* right = strchr(kFenCastling, c);
+      if (!right || !*right)
+        return false;
+      castling_ |= 1 << (right - kFenCastling);
+    }
+  }
+  // Drop rights the pieces can't back up, so the rest of the code can trust
+  // that the king and rook are home.
+  for (int right = 0; right < 4; ++right) {
+    Colors owner = (right < 2) ? kWhite : kBlack;
+    int back = RelativeRank(owner, 0);
+    Square rook(back, (right & 1) ? 0 : 7);
+    if (!(squares_[Square(back, 4)] == Piece(owner, kKing)) ||
+        !(squares_[rook] == Piece(owner, kRook))) {
+      castling_ &= ~(1 << right);
+    }
+  }
+  en_passant_ = Square::kInvalid;
+  if (en_passant != "-") {
+    if (en_passant.size() != 2)
+      return false;
+    Square square(en_passant);
+    if (!square.IsValid() || square.rank() != RelativeRank(color_, 5))
+      return false;
+    // The pawn that just jumped must be past the square, with the square and
+    // the one it jumped from both left empty.
+    Square pawn(RelativeRank(color_, 4), square.file());
+    Square start(RelativeRank(color_, 6), square.file());
+    if (!(squares_[pawn] == Piece(Toggle(color_), kPawn)) ||
+        squares_[square] || squares_[start])
+      return false;
+    // Same rule as EnPassantAfter(): only if a pawn can actually take.
+    if (PawnAttacks(Toggle(color_), square) & pieces_[color_][kPawn])
+      en_passant_ = square;
+  }
+  hash_ = ComputeHash();
+  UpdateCheckInfo();
+  // The side that just moved can't have left its king en prise.
+  return !IsChecking();
+}
+
+template <Colors kUs>
+void Board::MakeMove(Bitmove move, Undo* undo) {
+  const Colors kThem = Toggle(kUs);
+  Square source = move.source();
+  Square dest = move.dest();
+  Piece source_tile = squares_[source];
+  Square victim = (move.type() == kEnPassant) ? EnPassantVictim(move) : dest;
+  Piece dest_tile = squares_[victim];
+  DCHECK_EQ(kUs, color_);
+  DCHECK(source.IsValid()) << move;
+  DCHECK(dest.IsValid()) << move;
   DCHECK(source_tile.piece() != kEmpty) << source_tile;
-  DCHECK(source_tile.color() == color_) << source_tile;
+  DCHECK(source_tile.color() == kUs) << source_tile;
   DCHECK(IsLegal(move, false)) << move;
+  undo->captured = dest_tile;
+  undo->hash = hash_;
+  undo->checkers = checkers_;
+  undo->pinned = pinned_;
+  undo->castling = castling_;
+  undo->en_passant = en_passant_;
+  hash_ = HashAfter<kUs>(move);
+  en_passant_ = EnPassantAfter<kUs>(move);
+  castling_ &= kCastlingKept[source.index()] & kCastlingKept[dest.index()];
   if (source_tile.piece() == kKing) {
-    my_king_ = move.dest;
+    kings_[kUs] = dest;
   }
   if (!dest_tile.IsEmpty()) {
-    if (dest_tile.color() == color_) {
+    if (dest_tile.color() == kUs) {
       LOG(INFO) << *this << move;
     }
-    DCHECK(dest_tile.color() != color_);
-    their_lost_ += dest_tile.value();
-    enemies_ ^= move.dest_bit;
+    DCHECK(dest_tile.color() == kThem);
+    Bitboard bit(victim);
+    lost_[kThem] += dest_tile.value();
+    colors_[kThem] ^= bit;
+    pieces_[kThem][dest_tile.piece()] ^= bit;
+    squares_[victim] = Piece();
+  }
+  Piece placed = source_tile;
+  if (move.type() == kPromotion) {
+    placed = Piece(kUs, move.promotion());
+    lost_[kUs] -= placed.value() - source_tile.value();
   }
-  squares_[move.dest] = squares_[move.source];
-  squares_[move.source] = Piece();
-  friends_ ^= move.source_bit;
-  friends_ |= move.dest_bit;
-  color_ = Toggle(color_);
-  std::swap(my_lost_, their_lost_);
-  std::swap(friends_, enemies_);
-  std::swap(my_king_, their_king_);
+  pieces_[kUs][source_tile.piece()] ^= move.source_bit();
+  pieces_[kUs][placed.piece()] ^= move.dest_bit();
+  squares_[dest] = placed;
+  squares_[source] = Piece();
+  colors_[kUs] ^= move.source_bit() | move.dest_bit();
+  if (move.type() == kCastling) {
+    Square rook_source, rook_dest;
+    CastlingRook(move, &rook_source, &rook_dest);
+    Bitboard path = Bitboard(rook_source) | Bitboard(rook_dest);
+    squares_[rook_dest] = squares_[rook_source];
+    squares_[rook_source] = Piece();
+    colors_[kUs] ^= path;
+    pieces_[kUs][kRook] ^= path;
+  }
+  color_ = kThem;
+  UpdateCheckInfo<kThem>();
+  DCHECK_EQ(hash_, ComputeHash()) << *this << move;
+}
+
+template <Colors kUs>
+void Board::UnmakeMove(Bitmove move, const Undo& undo) {
+  const Colors kThem = Toggle(kUs);
+  DCHECK_EQ(kThem, color_);
+  color_ = kUs;
+  hash_ = undo.hash;
+  checkers_ = undo.checkers;
+  pinned_ = undo.pinned;
+  castling_ = undo.castling;
+  en_passant_ = undo.en_passant;
+  Square source = move.source();
+  Square dest = move.dest();
+  Piece placed = squares_[dest];
+  Piece piece = placed;
+  if (move.type() == kPromotion) {
+    piece = Piece(kUs, kPawn);
+    lost_[kUs] += placed.value() - piece.value();
+  }
+  if (piece.piece() == kKing) {
+    kings_[kUs] = source;
+  }
+  squares_[source] = piece;
+  squares_[dest] = Piece();
+  colors_[kUs] ^= move.source_bit() | move.dest_bit();
+  pieces_[kUs][piece.piece()] ^= move.source_bit();
+  pieces_[kUs][placed.piece()] ^= move.dest_bit();
+  if (move.type() == kCastling) {
+    Square rook_source, rook_dest;
+    CastlingRook(move, &rook_source, &rook_dest);
+    Bitboard path = Bitboard(rook_source) | Bitboard(rook_dest);
+    squares_[rook_source] = squares_[rook_dest];
+    squares_[rook_dest] = Piece();
+    colors_[kUs] ^= path;
+    pieces_[kUs][kRook] ^= path;
+  }
+  if (!undo.captured.IsEmpty()) {
+    Square victim = (move.type() == kEnPassant) ? EnPassantVictim(move) : dest;
+    Bitboard bit(victim);
+    squares_[victim] = undo.captured;
+    lost_[kThem] -= undo.captured.value();
+    colors_[kThem] |= bit;
+    pieces_[kThem][undo.captured.piece()] |= bit;
+  }
+}
+
+void Board::MakeMove(Bitmove move, Undo* undo) {
+  if (color_ == kWhite) {
+    MakeMove<kWhite>(move, undo);
+  } else {
+    MakeMove<kBlack>(move, undo);
+  }
+}
+
+void Board::UnmakeMove(Bitmove move, const Undo& undo) {
+  if (color_ == kBlack) {  // White made the move.
+    UnmakeMove<kWhite>(move, undo);
+  } else {
+    UnmakeMove<kBlack>(move, undo);
+  }
+}
+
+template <Colors kUs>
+uint64_t Board::HashAfter(Bitmove move) const {
+  Square source = move.source();
+  Square dest = move.dest();
+  Piece source_tile = squares_[source];
+  Piece placed = source_tile;
+  uint64_t res = (hash_ ^
+                  ZobristKey(source_tile, source) ^
+                  ZobristKey(squares_[dest], dest) ^
+                  g_zobrist_black);
+  switch (move.type()) {
+    case kPromotion:
+      placed = Piece(kUs, move.promotion());
+      break;
+    case kEnPassant: {
+      Square victim = EnPassantVictim(move);
+      res ^= ZobristKey(squares_[victim], victim);
+      break;
+    }
+    case kCastling: {
+      Square rook_source, rook_dest;
+      CastlingRook(move, &rook_source, &rook_dest);
+      Piece rook(kUs, kRook);
+      res ^= ZobristKey(rook, rook_source) ^ ZobristKey(rook, rook_dest);
+      break;
+    }
+    default:
+      break;
+  }
+  int castling = (castling_ & kCastlingKept[source.index()] &
+                  kCastlingKept[dest.index()]);
+  return (res ^
+          ZobristKey(placed, dest) ^
+          g_zobrist_castling[castling_] ^
+          g_zobrist_castling[castling] ^
+          ZobristEnPassant(en_passant_) ^
+          ZobristEnPassant(EnPassantAfter<kUs>(move)));
+}
+
+uint64_t Board::HashAfter(Bitmove move) const {
+  return ((color_ == kWhite) ?
+          HashAfter<kWhite>(move) :
+          HashAfter<kBlack>(move));
+}
+
+// A double push leaves a square behind that can be taken en passant. It's
+// only remembered if an enemy pawn is there to do it, so that positions
+// which play the same hash the same.
+template <Colors kUs>
+Square Board::EnPassantAfter(Bitmove move) const {
+  const int kForward = (kUs == kWhite) ? 1 : -1;
+  Square source = move.source();
+  Square dest = move.dest();
+  if (squares_[source].piece() != kPawn ||
+      dest.rank() - source.rank() != 2 * kForward) {
+    return Square::kInvalid;
+  }
+  Square skipped(source.rank() + kForward, source.file());
+  if (!(PawnAttacks(kUs, skipped) & pieces_[Toggle(kUs)][kPawn]))
+    return Square::kInvalid;
+  return skipped;
+}
+
+uint64_t Board::ComputeHash() const {
+  uint64_t res = (color_ == kBlack) ? g_zobrist_black : 0;
+  for (int rank = 0; rank < kRow; ++rank) {
+    for (int file = 0; file < kRow; ++file) {
+      Square square(rank, file);
+      res ^= ZobristKey(squares_[square], square);
+    }
+  }
+  return res ^ g_zobrist_castling[castling_] ^ ZobristEnPassant(en_passant_);
 }
 
 bool Board::operator==(const Board& other) const {
@@ -52,15 +381,32 @@ bool Board::operator==(const Board& other) const {
 }
 
 bool Board::IsChecking() const {
-  Bitboard king(their_king_);
-  for (int rank = 0; rank < kRow; ++rank) {
-    for (int file = 0; file < kRow; ++file) {
-      Square source(rank, file);
-      Piece piece = squares_[source];
-      if (piece.IsEmpty() || piece.color() != color_)
-        continue;
-      const Bitmove& move = GetBitmove(piece, source, their_king_);
-      if ((king & move.dest_bit) && IsLegal(move, false)) {
+  return IsAttacked(kings_[Toggle(color_)], color_);
+}
+
+bool Board::IsAttacked(Square square, Colors by) const {
+  Bitboard occupied = colors_[kWhite] | colors_[kBlack];
+  return ((by == kWhite) ?
+          IsAttacked<kWhite>(square, occupied) :
+          IsAttacked<kBlack>(square, occupied));
+}
+
+// Cheaper than AttackersOf() when the answer is usually no. Leapers are one
+// table load each. Sliders are few, and most aren't even lined up with
+// |square|, which the 0x88 delta table tells us without a magic lookup.
+template <Colors kBy>
+bool Board::IsAttacked(Square square, Bitboard occupied) const {
+  const Bitboard* mine = pieces_[kBy];
+  if ((KnightAttacks(square) & mine[kKnight]) ||
+      (KingAttacks(square) & mine[kKing]) ||
+      (PawnAttacks(Toggle(kBy), square) & mine[kPawn])) {
+    return true;
+  }
+  for (int piece = kBishop; piece <= kQueen; ++piece) {
+    for (Bitboard sliders = mine[piece]; sliders;) {
+      Square source = sliders.PopSquare();
+      if (MightAttack((Pieces)piece, source, square) &&
+          !(Between(source, square) & occupied)) {
         return true;
       }
     }
@@ -68,74 +414,420 @@ bool Board::IsChecking() const {
   return false;
 }
 
-bool Board::IsLegal(const Bitmove& move, bool check_check) const {
-  DCHECK(move.IsValid());
-  DCHECK(move.path);
-  Piece from = squares_[move.source];
-  Piece to = squares_[move.dest];
-  // Is dest a friend? Will I bump into any friends along the way?
-  if (move.path & friends_) {
-    VLOG(2) << from << " " << move << " is friend blocked\n\n"
-            << move.path << "\n"
-            << friends_;
-    return false;
+// Looks outward from |square| as each kind of piece, and keeps any piece of
+// that kind it sees.
+template <Colors kBy>
+Bitboard Board::AttackersOf(Square square, Bitboard occupied) const {
+  const Bitboard* mine = pieces_[kBy];
+  Bitboard queens = mine[kQueen];
+  // A pawn attacks us from wherever our own pawn would attack it.
+  return ((RookAttacks(square, occupied) & (mine[kRook] | queens)) |
+          (BishopAttacks(square, occupied) & (mine[kBishop] | queens)) |
+          (KnightAttacks(square) & mine[kKnight]) |
+          (KingAttacks(square) & mine[kKing]) |
+          (PawnAttacks(Toggle(kBy), square) & mine[kPawn]));
+}
+
+// Called whenever the side to move changes. Everything legality needs to
+// know about the king is worked out once here, instead of once per move.
+template <Colors kUs>
+void Board::UpdateCheckInfo() {
+  const Colors kThem = Toggle(kUs);
+  Square king = kings_[kUs];
+  Bitboard occupied = colors_[kWhite] | colors_[kBlack];
+  checkers_ = AttackersOf<kThem>(king, occupied);
+  // Enemy sliders that would hit the king if nothing were in the way. Any
+  // lone friend between one of them and the king is pinned.
+  pinned_ = Bitboard();
+  const Bitboard* theirs = pieces_[kThem];
+  Bitboard snipers =
+      ((RookAttacks(king, Bitboard()) &
+        (theirs[kRook] | theirs[kQueen])) |
+       (BishopAttacks(king, Bitboard()) &
+        (theirs[kBishop] | theirs[kQueen])));
+  while (snipers) {
+    Bitboard blockers = Between(king, snipers.PopSquare()) & occupied;
+    if (blockers && !(blockers.bits() & (blockers.bits() - 1)) &&
+        (blockers & colors_[kUs])) {
+      pinned_ |= blockers;
+    }
   }
-  // Do any squares on the way to dest contain enemies blocking us?
-  if ((move.path ^ move.dest_bit) & enemies_) {
-    VLOG(2) << from << " " << move << " is blocked by enemies";
-    return false;
+}
+
+void Board::UpdateCheckInfo() {
+  if (color_ == kWhite) {
+    UpdateCheckInfo<kWhite>();
+  } else {
+    UpdateCheckInfo<kBlack>();
   }
+}
+
+bool Board::IsLegal(Bitmove move, bool check_check) const {
+  DCHECK(move.IsValid());
+  Bitboard path = move.path();
+  Piece from = squares_[move.source()];
+  Piece to = squares_[move.dest()];
   DCHECK(from.color() == color_);
   DCHECK(from.piece() != kEmpty);
-  // Pawns can only change file when attacking.
-  if (from.piece() == kPawn && to.piece() == kEmpty &&
-      move.source.file() != move.dest.file()) {
-    VLOG(2) << from << " " << move << " pawn not attacking";
-    return false;
+  switch (move.type()) {
+    case kCastling:
+      // Rights mean the king and rook are home, so what's left is the empty
+      // squares between them, which the king's path alone doesn't cover.
+      if (from.piece() != kKing ||
+          ((color_ == kWhite) ?
+           CastlingMove<kWhite>(move.dest().file() == 2) :
+           CastlingMove<kBlack>(move.dest().file() == 2)) != move) {
+        VLOG(2) << from << " " << move << " can't castle";
+        return false;
+      }
+      break;
+    case kEnPassant:
+      if (from.piece() != kPawn || !(move.dest() == en_passant_) ||
+          !(PawnAttacks(color_, move.source()) & move.dest_bit())) {
+        VLOG(2) << from << " " << move << " can't take en passant";
+        return false;
+      }
+      break;
+    default:
+      // Is dest a friend? Will I bump into any friends along the way?
+      if (path & colors_[color_]) {
+        VLOG(2) << from << " " << move << " is friend blocked\n\n"
+                << path << "\n"
+                << colors_[color_];
+        return false;
+      }
+      // Do any squares on the way to dest contain enemies blocking us?
+      if ((path ^ move.dest_bit()) & colors_[Toggle(color_)]) {
+        VLOG(2) << from << " " << move << " is blocked by enemies";
+        return false;
+      }
+      // Pawns can only change file when attacking, and only then.
+      if (from.piece() == kPawn &&
+          (to.piece() == kEmpty) !=
+          (move.source().file() == move.dest().file())) {
+        VLOG(2) << from << " " << move << " pawn not attacking diagonally";
+        return false;
+      }
+      // Pawns must promote on the last rank, and nothing else can.
+      if ((move.type() == kPromotion) !=
+          (from.piece() == kPawn &&
+           move.dest().rank() == RelativeRank(color_, kRow - 1))) {
+        VLOG(2) << from << " " << move << " promotes wrongly";
+        return false;
+      }
+      break;
   }
   // Does this move put me in check?
-  if (check_check && Board(*this, move).IsChecking())
+  if (check_check && !LeavesKingSafe(move))
     return false;
   return true;
 }
 
-Bitmoves Board::PossibleMoves() const {
-  Bitmoves res;
-  for (int rank = 0; rank < kRow; ++rank) {
-    for (int file = 0; file < kRow; ++file) {
-      Square source(rank, file);
-      Piece piece = squares_[source];
-      if (piece.IsEmpty() || piece.color() != color_)
-        continue;
-      for (const Bitmove& move : GetBitmoves(piece, source)) {
-        if (IsLegal(move, true)) {
-          res.push_back(move);
-        }
-      }
+// |move| must be pseudo-legal.
+template <Colors kUs>
+bool Board::LeavesKingSafe(Bitmove move) const {
+  const Colors kThem = Toggle(kUs);
+  Square king = kings_[kUs];
+  Bitboard occupied = colors_[kWhite] | colors_[kBlack];
+  if (move.type() == kCastling) {
+    // Can't castle out of, through or into check. The rook lands between
+    // the king and anything that could see it along the back rank.
+    Square pass(move.source().rank(),
+                (move.source().file() + move.dest().file()) / 2);
+    return (!checkers_ &&
+            !IsAttacked<kThem>(pass, occupied) &&
+            !IsAttacked<kThem>(move.dest(), occupied));
+  }
+  if (move.type() == kEnPassant) {
+    // Two pawns leave the same rank at once, which pins don't account for,
+    // so just look at the board as it will be.
+    Bitboard victim = Bitboard(EnPassantVictim(move));
+    occupied = (occupied ^ move.source_bit() ^ victim) | move.dest_bit();
+    return !(AttackersOf<kThem>(king, occupied) & ~victim);
+  }
+  if (move.source() == king) {
+    // Take the king off the board so it can't hide behind itself from a
+    // slider it's stepping away from.
+    return !IsAttacked<kThem>(move.dest(), occupied ^ move.source_bit());
+  }
+  if (checkers_) {
+    // Two checkers can't both be blocked or taken by one non-king move.
+    if (checkers_.bits() & (checkers_.bits() - 1))
+      return false;
+    Square checker = Bitboard(checkers_).PopSquare();
+    if (!((Between(king, checker) | checkers_) & move.dest_bit()))
+      return false;
+  }
+  return (!(pinned_ & move.source_bit()) ||
+          (Line(king, move.source()) & move.dest_bit()));
+}
+
+bool Board::LeavesKingSafe(Bitmove move) const {
+  return ((color_ == kWhite) ?
+          LeavesKingSafe<kWhite>(move) :
+          LeavesKingSafe<kBlack>(move));
+}
+
+// Castling for the side to move, if it has the right and nothing is in the
+// way. Whether the king would pass through check is up to LeavesKingSafe().
+template <Colors kUs>
+Bitmove Board::CastlingMove(int side) const {
+  const int kBackRank = RelativeRank(kUs, 0);
+  Square king(kBackRank, 4);
+  Square rook(kBackRank, side ? 0 : kRow - 1);
+  if (!(castling_ & (kWhiteKingside << (kUs * 2 + side))) ||
+      (Between(king, rook) & (colors_[kWhite] | colors_[kBlack]))) {
+    return Bitmove::kInvalid;
+  }
+  return Bitmove(king, Square(kBackRank, side ? 2 : 6), kCastling);
+}
+
+template <Colors kUs>
+MoveList Board::PossibleMoves() const {
+  return LegalMoves<kUs>(~colors_[kUs]);
+}
+
+template <Colors kUs>
+MoveList Board::PossibleCaptures() const {
+  return LegalMoves<kUs>(colors_[Toggle(kUs)]);
+}
+
+MoveList Board::PossibleMoves() const {
+  return ((color_ == kWhite) ?
+          PossibleMoves<kWhite>() :
+          PossibleMoves<kBlack>());
+}
+
+MoveList Board::PossibleCaptures() const {
+  return ((color_ == kWhite) ?
+          PossibleCaptures<kWhite>() :
+          PossibleCaptures<kBlack>());
+}
+
+template <Colors kUs>
+int Board::GenerateEvasions(Bitmove* moves) const {
+  return GenerateEvasions<kUs>(~colors_[kUs], moves);
+}
+
+// Evasions that land on |targets|. Nothing but the king can answer a double
+// check. Otherwise other pieces only need to look at the checker and the
+// squares between it and the king, and the king just steps off elsewhere.
+template <Colors kUs>
+int Board::GenerateEvasions(Bitboard targets, Bitmove* moves) const {
+  DCHECK(checkers_);
+  Square king = kings_[kUs];
+  int count = 0;
+  Bitboard blocks;
+  if (!(checkers_.bits() & (checkers_.bits() - 1))) {
+    blocks = Between(king, Bitboard(checkers_).PopSquare()) | checkers_;
+    count = GenerateMoves<kUs>(blocks & targets, moves);
+  }
+  for (Bitboard dests = KingAttacks(king) & ~colors_[kUs] & ~blocks & targets;
+       dests;) {
+    moves[count++] = Bitmove(king, dests.PopSquare());
+  }
+  return count;
+}
+
+int Board::GenerateCaptures(Bitmove* moves) const {
+  return ((color_ == kWhite) ?
+          GenerateCaptures<kWhite>(moves) :
+          GenerateCaptures<kBlack>(moves));
+}
+
+int Board::GenerateQuiets(Bitmove* moves) const {
+  return ((color_ == kWhite) ?
+          GenerateQuiets<kWhite>(moves) :
+          GenerateQuiets<kBlack>(moves));
+}
+
+int Board::GenerateEvasions(Bitmove* moves) const {
+  return ((color_ == kWhite) ?
+          GenerateEvasions<kWhite>(moves) :
+          GenerateEvasions<kBlack>(moves));
+}
+
+template <Colors kUs>
+MoveList Board::LegalMoves(Bitboard targets) const {
+  MoveList res;
+  int count = (checkers_ ?
+               GenerateEvasions<kUs>(targets, res.data()) :
+               GenerateMoves<kUs>(targets, res.data()));
+  int legal = 0;
+  for (int n = 0; n < count; ++n) {
+    if (LeavesKingSafe<kUs>(res[n])) {
+      res[legal++] = res[n];
     }
   }
+  res.resize(legal);
   return res;
 }
 
-const Bitmove& Board::ComposeMove(Square source, Square dest) const {
+// One rank towards the far side of the board, for kUs pawns.
+template <Colors kUs>
+static inline Bitboard PawnPush(Bitboard pawns) {
+  return (kUs == kWhite) ? ShiftUp(pawns) : ShiftDown(pawns);
+}
+
+// Adds a pawn move to each of |dests|, from |ranks| back and |files| over.
+// Moves onto the last rank become one move per promotion: best piece first,
+// then the knight since it can do what a queen can't. Rooks and bishops are
+// only there for stalemate tricks.
+template <Colors kUs>
+static inline int AddPawnMoves(Bitboard dests, int ranks, int files,
+                               Bitmove* moves, int count) {
+  const int kBack = (kUs == kWhite) ? -ranks : ranks;
+  const Bitboard kLastRank = RankMask(RelativeRank(kUs, kRow - 1));
+  for (Bitboard normal = dests & ~kLastRank; normal;) {
+    Square dest = normal.PopSquare();
+    moves[count++] = Bitmove(Square(dest.rank() + kBack, dest.file() - files),
+                             dest);
+  }
+  for (Bitboard promoted = dests & kLastRank; promoted;) {
+    Square dest = promoted.PopSquare();
+    Square source(dest.rank() + kBack, dest.file() - files);
+    for (Pieces piece : {kQueen, kKnight, kRook, kBishop}) {
+      moves[count++] = Bitmove(source, dest, kPromotion, piece);
+    }
+  }
+  return count;
+}
+
+template <Colors kUs>
+int Board::GenerateMoves(Bitboard targets, Bitmove* moves,
+                         Bitboard pushes) const {
+  const Colors kThem = Toggle(kUs);
+  int count = 0;
+  Bitboard occupied = colors_[kWhite] | colors_[kBlack];
+  const Bitboard* mine = pieces_[kUs];
+  // Pawns move all at once: shift the whole set forward, keep what lands
+  // somewhere allowed, and work each source out from its dest.
+  Bitboard pawns = mine[kPawn];
+  Bitboard empty = ~occupied;
+  Bitboard pushed = PawnPush<kUs>(pawns) & empty;
+  Bitboard jumped = (PawnPush<kUs>(pushed & RankMask(RelativeRank(kUs, 2))) &
+                     empty);
+  Bitboard prey = colors_[kThem] & targets;
+  count = AddPawnMoves<kUs>(pushed & targets & pushes, 1, 0, moves, count);
+  count = AddPawnMoves<kUs>(jumped & targets & pushes, 2, 0, moves, count);
+  count = AddPawnMoves<kUs>(PawnPush<kUs>(ShiftLeft(pawns)) & prey, 1, -1,
+                            moves, count);
+  count = AddPawnMoves<kUs>(PawnPush<kUs>(ShiftRight(pawns)) & prey, 1, 1,
+                            moves, count);
+  // Taking en passant counts as a capture of the pawn, not the square.
+  if (en_passant_.IsValid()) {
+    Square victim(en_passant_.rank() - ((kUs == kWhite) ? 1 : -1),
+                  en_passant_.file());
+    if (targets & Bitboard(victim)) {
+      Bitboard takers = PawnAttacks(kThem, en_passant_) & mine[kPawn];
+      while (takers) {
+        moves[count++] = Bitmove(takers.PopSquare(), en_passant_, kEnPassant);
+      }
+    }
+  }
+  // Everything else goes wherever it attacks. Sliders only ever see squares
+  // they can actually reach, so there's no need to reject blocked rays.
+  for (int piece = kKnight; piece <= kKing; ++piece) {
+    for (Bitboard sources = mine[piece]; sources;) {
+      Square source = sources.PopSquare();
+      Bitboard dests;
+      switch (piece) {
+        case kKnight: dests = KnightAttacks(source); break;
+        case kKing:   dests = KingAttacks(source); break;
+        default:
+          dests = SliderAttacks((Pieces)piece, source, occupied);
+          break;
+      }
+      for (dests &= targets; dests;) {
+        moves[count++] = Bitmove(source, dests.PopSquare());
+      }
+    }
+  }
+  // The king lands on an empty square, so castling is quiet.
+  for (int side = 0; side < 2; ++side) {
+    Bitmove move = CastlingMove<kUs>(side);
+    if (move.IsValid() && (move.dest_bit() & targets)) {
+      moves[count++] = move;
+    }
+  }
+  DCHECK_LE(count, kMaxMoves);
+  return count;
+}
+
+// Promotions win material as surely as captures do, so pushes onto the last
+// rank come with the captures rather than the quiets.
+template <Colors kUs>
+int Board::GenerateCaptures(Bitmove* moves) const {
+  int count = GenerateMoves<kUs>(colors_[Toggle(kUs)], moves);
+  Bitboard empty = ~(colors_[kWhite] | colors_[kBlack]);
+  Bitboard promoting = (PawnPush<kUs>(pieces_[kUs][kPawn]) & empty &
+                        RankMask(RelativeRank(kUs, kRow - 1)));
+  return AddPawnMoves<kUs>(promoting, 1, 0, moves, count);
+}
+
+template <Colors kUs>
+int Board::GenerateQuiets(Bitmove* moves) const {
+  return GenerateMoves<kUs>(~(colors_[kWhite] | colors_[kBlack]), moves,
+                            ~RankMask(RelativeRank(kUs, kRow - 1)));
+}
+
+bool Board::IsPseudoLegal(Bitmove move) const {
+  if (!move.IsValid())
+    return false;
+  Piece from = squares_[move.source()];
+  if (from.IsEmpty() || from.color() != color_)
+    return false;
+  // Anything from a table could be garbage, so make sure it's a real move.
+  // IsLegal() checks castling and en passant in full.
+  switch (move.type()) {
+    case kNormalMove:
+      if (GetBitmove(from, move.source(), move.dest()) != move)
+        return false;
+      break;
+    case kPromotion:
+      if (!GetBitmove(from, move.source(), move.dest()).IsValid())
+        return false;
+      break;
+    default:
+      break;
+  }
+  return IsLegal(move, false);
+}
+
+// Looks |source| to |dest| up among the legal moves, so castling is typed as
+// the king's move and pawns that reach the last rank become queens.
+Bitmove Board::ComposeMove(Square source, Square dest) const {
   DCHECK(source.IsValid());
   DCHECK(dest.IsValid());
   Piece from = squares_[source];
-  if (from.IsEmpty()) {
-    VLOG(2) << source << " is an empty square";
-    return Bitmove::kInvalid;
-  }
-  const Bitmove& move = GetBitmove(from, source, dest);
-  if (!move.IsValid()) {
-    VLOG(2) << from << " " << source  << dest << " not a valid move";
+  if (from.IsEmpty() || from.color() != color_) {
+    VLOG(2) << source << " is not ours to move";
     return Bitmove::kInvalid;
   }
-  if (!IsLegal(move, true)) {
-    return Bitmove::kInvalid;
+  for (const Bitmove& move : PossibleMoves()) {
+    if (move.source() == source && move.dest() == dest) {
+      return move;  // Queen promotions come first.
+    }
   }
-  return move;
+  VLOG(2) << from << " " << source << dest << " not a legal move";
+  return Bitmove::kInvalid;
 }
 
+// Search calls these directly for whichever side it knows is to move.
+#define INSTANTIATE_FOR(kUs)                                    \
+  template uint64_t Board::HashAfter<kUs>(Bitmove) const;       \
+  template MoveList Board::PossibleMoves<kUs>() const;          \
+  template MoveList Board::PossibleCaptures<kUs>() const;       \
+  template int Board::GenerateCaptures<kUs>(Bitmove*) const;    \
+  template int Board::GenerateQuiets<kUs>(Bitmove*) const;      \
+  template int Board::GenerateEvasions<kUs>(Bitmove*) const;    \
+  template bool Board::LeavesKingSafe<kUs>(Bitmove) const;      \
+  template void Board::MakeMove<kUs>(Bitmove, Undo*);           \
+  template void Board::UnmakeMove<kUs>(Bitmove, const Undo&);
+INSTANTIATE_FOR(kWhite)
+INSTANTIATE_FOR(kBlack)
+#undef INSTANTIATE_FOR
+
 const Piece Board::kInitialSquares[128] = {
   [Square(0, 0)] = Piece(kWhite, kRook),
   [Square(0, 1)] = Piece(kWhite, kKnight),
@@ -171,9 +863,6 @@ const Piece Board::kInitialSquares[128] = {
   [Square(6, 7)] = Piece(kBlack, kPawn),
 };
 
-const Bitboard Board::kInitialFriends = Bitboard(0x000000000000ffff);
-const Bitboard Board::kInitialEnemies = Bitboard(0xffff000000000000);
-
 std::ostream& operator<<(std::ostream& os, const Board& board) {
   board.Print(os, true);
   return os;
@@ -3,42 +3,154 @@
 #ifndef CHESSY_BOARD_H_
 #define CHESSY_BOARD_H_
 
+#include <cstdint>
 #include <functional>
 #include <ostream>
+#include <string>
 
 #include "bitmove.h"
 
 namespace chessy {
 
+// Castling rights, as a mask. Each color's kingside right comes right before
+// its queenside one, so shifting by color * 2 finds black's.
+enum Castling {
+  kWhiteKingside  = 1,
+  kWhiteQueenside = 2,
+  kBlackKingside  = 4,
+  kBlackQueenside = 8,
+  kAllCastling    = 15,
+};
+
+// Most of the interface comes in two flavors. Code that already knows whose
+// turn it is, like the recursion in search, calls the template with kUs set
+// to color(), which makes pawn directions, promotion ranks and which pieces
+// are friends compile-time constants. The plain versions just look at
+// color() and call the right template.
 class Board {
  public:
+  // Everything MakeMove() overwrites that can't be worked out again from the
+  // move itself. Material lost is restored from the value of |captured|.
+  struct Undo {
+    Piece captured;
+    uint64_t hash;
+    Bitboard checkers;
+    Bitboard pinned;
+    uint8_t castling;
+    Square en_passant;
+  };
+
   Board();
-  Board(const Board& old, const Bitmove& move);
+  Board(const Board& old, Bitmove move);
   Board(const Board& old) = delete;
+  // Sets up the position in Forsyth-Edwards Notation. Returns false, leaving
+  // the board in an unspecified state, if |fen| doesn't make sense.
+  bool LoadFen(const std::string& fen);
   inline Colors color() const { return color_; }
-  inline int score() const { return their_lost_ - my_lost_; }
+  inline int score() const { return lost_[Toggle(color_)] - lost_[color_]; }
   inline Piece GetPiece(Square square) const { return squares_[square]; }
+  inline Bitboard pieces(Colors color, Pieces piece) const {
+    return pieces_[color][piece];
+  }
+  inline Bitboard pieces(Colors color) const { return colors_[color]; }
+  inline Square king(Colors color) const { return kings_[color]; }
   bool IsChecking() const;  // Are we putting the other player in check?
-  size_t Hash() const { return (friends_ ^ enemies_).bits(); }
+  bool IsAttacked(Square square, Colors by) const;
+  inline bool InCheck() const { return checkers_; }  // Are we in check?
+  inline Bitboard checkers() const { return checkers_; }
+  inline Bitboard pinned() const { return pinned_; }
+  inline int castling() const { return castling_; }
+  inline Square en_passant() const { return en_passant_; }  // Or kInvalid.
+  inline bool IsCapture(Bitmove move) const {
+    return GetPiece(move.dest()) || move.type() == kEnPassant;
+  }
+  // Neither takes anything nor promotes, as GenerateQuiets() means it.
+  inline bool IsQuiet(Bitmove move) const {
+    return !IsCapture(move) && move.type() != kPromotion;
+  }
+  // Material |move| wins outright: what it takes, a pawn if en passant, plus
+  // what a promoting pawn turns into over the pawn it was.
+  inline int CaptureGain(Bitmove move) const {
+    const int kPawnValue = Piece(kWhite, kPawn).value();
+    int gain = (move.type() == kEnPassant) ? kPawnValue
+                                           : GetPiece(move.dest()).value();
+    if (move.type() == kPromotion) {
+      gain += Piece(kWhite, move.promotion()).value() - kPawnValue;
+    }
+    return gain;
+  }
+  // Sort key for captures and promotions, highest first: biggest
+  // CaptureGain(), least valuable attacker breaking ties (MVV-LVA). Quiesce()
+  // counts on moves sorted by this also being sorted by CaptureGain().
+  inline int CaptureOrder(Bitmove move) const {
+    return CaptureGain(move) * kPieces - GetPiece(move.source()).piece();
+  }
+  uint64_t Hash() const { return hash_; }  // Zobrist key.
+  uint64_t ComputeHash() const;  // Slow way to get Hash(), for checking it.
+  template <Colors kUs> uint64_t HashAfter(Bitmove move) const;
+  uint64_t HashAfter(Bitmove move) const;  // Hash() of the child.
   bool operator==(const Board& other) const;
   void Print(std::ostream& os, bool redraw) const;
-  Bitmoves PossibleMoves() const;
-  bool IsLegal(const Bitmove& move, bool check_check) const;
-  const Bitmove& ComposeMove(Square source, Square dest) const;
+  template <Colors kUs> MoveList PossibleMoves() const;
+  template <Colors kUs> MoveList PossibleCaptures() const;
+  MoveList PossibleMoves() const;
+  MoveList PossibleCaptures() const;  // Just the legal moves that take a piece.
+  bool IsLegal(Bitmove move, bool check_check) const;
+  Bitmove ComposeMove(Square source, Square dest) const;
+
+  // Pseudo-legal moves, which follow the rules of movement but might leave
+  // our own king in check. Writes at most kMaxMoves and returns the count.
+  // Promotions count as captures whether or not they take anything.
+  template <Colors kUs> int GenerateCaptures(Bitmove* moves) const;
+  template <Colors kUs> int GenerateQuiets(Bitmove* moves) const;
+  int GenerateCaptures(Bitmove* moves) const;
+  int GenerateQuiets(Bitmove* moves) const;
+  // Only ways out of check, for when InCheck(): king moves, taking the
+  // checker, and blocking its line. Far fewer than captures plus quiets.
+  template <Colors kUs> int GenerateEvasions(Bitmove* moves) const;
+  int GenerateEvasions(Bitmove* moves) const;
+  bool IsPseudoLegal(Bitmove move) const;  // For moves from tables.
+  template <Colors kUs> bool LeavesKingSafe(Bitmove move) const;
+  bool LeavesKingSafe(Bitmove move) const;  // Completes legality.
+
+  // Plays |move| in place, which is much cheaper than copy-constructing a
+  // child board. UnmakeMove() must be passed the same move and undo record,
+  // and kUs is the side that made the move, so no longer color().
+  template <Colors kUs> void MakeMove(Bitmove move, Undo* undo);
+  template <Colors kUs> void UnmakeMove(Bitmove move, const Undo& undo);
+  void MakeMove(Bitmove move, Undo* undo);
+  void UnmakeMove(Bitmove move, const Undo& undo);
 
  private:
+  // |pushes| further limits where pawns may move forward to.
+  template <Colors kUs> int GenerateMoves(
+      Bitboard targets, Bitmove* moves,
+      Bitboard pushes = Bitboard(~0ull)) const;
+  template <Colors kUs> int GenerateEvasions(Bitboard targets,
+                                             Bitmove* moves) const;
+  template <Colors kUs> MoveList LegalMoves(Bitboard targets) const;
+  template <Colors kBy> Bitboard AttackersOf(Square square,
+                                             Bitboard occupied) const;
+  template <Colors kBy> bool IsAttacked(Square square,
+                                        Bitboard occupied) const;
+  template <Colors kUs> void UpdateCheckInfo();
+  template <Colors kUs> Bitmove CastlingMove(int side) const;
+  template <Colors kUs> Square EnPassantAfter(Bitmove move) const;
+  void UpdateCheckInfo();
+
   static const Piece kInitialSquares[128];
-  static const Bitboard kInitialFriends;
-  static const Bitboard kInitialEnemies;
 
   Piece squares_[128];   // Maps Square to Piece. Canonical state of board.
   Colors color_;         // Current color playing the board (starts as kWhite).
-  Bitboard friends_;     // Mask of pieces on our team.
-  Bitboard enemies_;     // Mask of pieces on other team.
-  Square my_king_;       // Where is current player's king?
-  Square their_king_;    // Where is other player's king?
-  int my_lost_;          // Sum of value of pieces lost by current player.
-  int their_lost_;       // Sum of value of pieces lost by other player.
+  Bitboard colors_[kColors];  // Mask of each color's pieces.
+  Bitboard pieces_[kColors][kPieces];  // Mask of each piece, by color.
+  Square kings_[kColors];  // Where each king is.
+  int lost_[kColors];    // Sum of value of pieces each color has lost.
+  uint64_t hash_;        // Zobrist key, maintained by MakeMove().
+  Bitboard checkers_;    // Enemy pieces giving check to my king.
+  Bitboard pinned_;      // Friends that can't leave the line to my king.
+  uint8_t castling_;     // Castling rights that are left, see Castling.
+  Square en_passant_;    // Where a pawn can be taken en passant, or kInvalid.
 };
 
 std::ostream& operator<<(std::ostream& os, const Board& board);
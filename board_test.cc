@@ -1,6 +1,261 @@
+#include "bitmove.h"
 #include "board.h"
+#include "random_games.h"
+#include "transtable.h"
+#include <algorithm>
+#include <cstdlib>
 #include <gtest/gtest.h>
 
+using namespace chessy;
+
+class ChessyEnvironment : public ::testing::Environment {
+ public:
+  virtual void SetUp() {
+    InitBitmoves();
+    // Like main() does with --hash_mb. Until then the table has one cluster,
+    // and the null-window drivers can't keep bounds between passes.
+    g_transtable.Resize(16);
+  }
+};
+
+static ::testing::Environment* const g_env =
+    ::testing::AddGlobalTestEnvironment(new ChessyEnvironment);
+
 TEST(BoardTest, Basic) {
   EXPECT_TRUE(true);
 }
+
+TEST(BoardTest, InitialPosition) {
+  Board board;
+  EXPECT_EQ(20u, board.PossibleMoves().size());
+}
+
+static void Play(Board* board, const char* source, const char* dest) {
+  const Bitmove& move = board->ComposeMove(source, dest);
+  ASSERT_TRUE(move.IsValid()) << source << dest;
+  *board = Board(*board, move);
+}
+
+TEST(BoardTest, HashTranspositions) {
+  Board a;
+  Play(&a, "g1", "f3");
+  Play(&a, "g8", "f6");
+  Play(&a, "b1", "c3");
+  Board b;
+  Play(&b, "b1", "c3");
+  Play(&b, "g8", "f6");
+  Play(&b, "g1", "f3");
+  EXPECT_EQ(a.Hash(), b.Hash());
+  EXPECT_EQ(a.ComputeHash(), a.Hash());
+  Play(&b, "f6", "g8");
+  EXPECT_NE(a.Hash(), b.Hash());
+}
+
+TEST(BoardTest, UnmakeRestoresHash) {
+  Board board;
+  uint64_t hash = board.Hash();
+  for (const Bitmove& move : board.PossibleMoves()) {
+    Board::Undo undo;
+    board.MakeMove(move, &undo);
+    EXPECT_NE(hash, board.Hash()) << move;
+    board.UnmakeMove(move, undo);
+    EXPECT_EQ(hash, board.Hash()) << move;
+  }
+}
+
+TEST(BoardTest, PawnsCaptureOnlyDiagonally) {
+  Board board;
+  Play(&board, "e2", "e4");
+  Play(&board, "e7", "e5");
+  EXPECT_FALSE(board.ComposeMove("e4", "e5").IsValid());
+  EXPECT_EQ(0u, board.PossibleCaptures().size());
+  Play(&board, "d2", "d4");
+  Play(&board, "d8", "h4");
+  Play(&board, "g2", "g3");
+  Play(&board, "b8", "c6");
+  EXPECT_FALSE(board.ComposeMove("h2", "h4").IsValid());
+  EXPECT_EQ(2u, board.PossibleCaptures().size());  // dxe5 and gxh4.
+}
+
+TEST(BoardTest, DoublePushNeedsEmptyPath) {
+  Board board;
+  Play(&board, "b1", "c3");
+  Play(&board, "g8", "h6");
+  EXPECT_FALSE(board.ComposeMove("c2", "c4").IsValid());  // Our knight.
+  Play(&board, "a2", "a3");
+  Play(&board, "h6", "g4");
+  Play(&board, "a3", "a4");
+  Play(&board, "g4", "e3");
+  EXPECT_FALSE(board.ComposeMove("e2", "e4").IsValid());  // Their knight.
+  EXPECT_FALSE(board.ComposeMove("e2", "e3").IsValid());
+  EXPECT_TRUE(board.ComposeMove("d2", "e3").IsValid());
+}
+
+TEST(BoardTest, PinnedPieceStaysOnLine) {
+  Board board;
+  Play(&board, "e2", "e4");
+  Play(&board, "d7", "d6");
+  Play(&board, "d2", "d4");
+  Play(&board, "e8", "d7");  // Walks into a pin once the bishop comes.
+  Play(&board, "f1", "b5");
+  EXPECT_TRUE(board.InCheck());
+  EXPECT_EQ(Bitboard(Square("b5")).bits(), board.checkers().bits());
+  EXPECT_TRUE(board.ComposeMove("c7", "c6").IsValid());  // Blocks.
+  EXPECT_TRUE(board.ComposeMove("d7", "e6").IsValid());  // Runs.
+  EXPECT_FALSE(board.ComposeMove("g8", "f6").IsValid());  // Ignores it.
+  Play(&board, "c7", "c6");
+  Play(&board, "g1", "f3");
+  EXPECT_FALSE(board.InCheck());
+  EXPECT_EQ(Bitboard(Square("c6")).bits(), board.pinned().bits());
+  EXPECT_FALSE(board.ComposeMove("c6", "c5").IsValid());
+  EXPECT_TRUE(board.ComposeMove("c6", "b5").IsValid());  // Takes the pinner.
+}
+
+TEST(BoardTest, Checkmate) {
+  Board board;
+  Play(&board, "f2", "f3");
+  Play(&board, "e7", "e5");
+  Play(&board, "g2", "g4");
+  Play(&board, "d8", "h4");
+  EXPECT_TRUE(board.InCheck());
+  EXPECT_EQ(0u, board.PossibleMoves().size());
+}
+
+TEST(BoardTest, SpecialMovesFromSquares) {
+  Board board;
+  ASSERT_TRUE(board.LoadFen("r3k2r/1P6/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1"));
+  Bitmove castle = board.ComposeMove("e1", "g1");
+  EXPECT_EQ(kCastling, castle.type());
+  Bitmove promote = board.ComposeMove("b7", "a8");
+  EXPECT_EQ(kPromotion, promote.type());
+  EXPECT_EQ(kQueen, promote.promotion());
+  EXPECT_EQ(kEnPassant, board.ComposeMove("e5", "d6").type());
+  EXPECT_EQ(100, board.CaptureGain(board.ComposeMove("e5", "d6")));
+  EXPECT_EQ(500 + 900 - 100, board.CaptureGain(promote));
+  uint64_t hash = board.Hash();
+  Board::Undo undo;
+  board.MakeMove(castle, &undo);
+  EXPECT_EQ(Piece(kWhite, kRook), board.GetPiece(Square("f1")));
+  EXPECT_EQ(kBlackKingside | kBlackQueenside, board.castling());
+  EXPECT_FALSE(board.en_passant().IsValid());
+  board.UnmakeMove(castle, undo);
+  EXPECT_EQ(Piece(kWhite, kRook), board.GetPiece(Square("h1")));
+  EXPECT_EQ(hash, board.Hash());
+  int score = board.score();
+  board.MakeMove(promote, &undo);  // Takes the rook, so black loses a right.
+  EXPECT_EQ(kWhiteKingside | kWhiteQueenside | kBlackKingside,
+            board.castling());
+  EXPECT_EQ(-(score + 900 - 100 + 500), board.score());
+}
+
+// An en passant square is only believable right after a double push: the
+// pawn in front of it, and nothing on it or where the pawn came from.
+TEST(BoardTest, LoadFenChecksEnPassant) {
+  Board board;
+  ASSERT_TRUE(board.LoadFen("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1"));
+  EXPECT_EQ(Square("d6"), board.en_passant());
+  ASSERT_TRUE(board.LoadFen("4k3/8/8/8/3Pp3/8/8/4K3 b - d3 0 1"));
+  EXPECT_EQ(Square("d3"), board.en_passant());
+  EXPECT_FALSE(board.LoadFen("4k3/8/8/4P3/8/8/8/4K3 w - d6 0 1"));
+  EXPECT_FALSE(board.LoadFen("4k3/8/8/3nP3/8/8/8/4K3 w - d6 0 1"));
+  EXPECT_FALSE(board.LoadFen("4k3/8/8/3PP3/8/8/8/4K3 w - d6 0 1"));
+  EXPECT_FALSE(board.LoadFen("4k3/8/3n4/3pP3/8/8/8/4K3 w - d6 0 1"));
+  EXPECT_FALSE(board.LoadFen("4k3/3n4/8/3pP3/8/8/8/4K3 w - d6 0 1"));
+}
+
+// Legality from checkers and pins must agree with actually playing each move
+// and seeing if the king can be taken. Castling is the exception, since it
+// also can't start in or pass through check, which playing it can't show.
+TEST(BoardTest, LegalityMatchesMakeMove) {
+  std::srand(3);
+  ForEachRandomPosition(50, 120, [](Board* board, const MoveList&) {
+    Bitmove pseudo[kMaxMoves];
+    int count = board->GenerateCaptures(pseudo);
+    count += board->GenerateQuiets(pseudo + count);
+    for (int n = 0; n < count; ++n) {
+      if (pseudo[n].type() == kCastling)
+        continue;
+      Board::Undo undo;
+      board->MakeMove(pseudo[n], &undo);
+      bool safe = !board->IsChecking();
+      board->UnmakeMove(pseudo[n], undo);
+      ASSERT_EQ(safe, board->LeavesKingSafe(pseudo[n]))
+          << *board << pseudo[n];
+    }
+  });
+}
+
+// In check, the evasion generator may skip moves but never a legal one.
+TEST(BoardTest, EvasionsKeepEveryLegalMove) {
+  std::srand(11);
+  int checks = 0;
+  ForEachRandomPosition(100, 120, [&checks](Board* board, const MoveList&) {
+    if (!board->InCheck())
+      return;
+    ++checks;
+    Bitmove pseudo[kMaxMoves];
+    int count = board->GenerateCaptures(pseudo);
+    count += board->GenerateQuiets(pseudo + count);
+    Bitmove evasions[kMaxMoves];
+    int evasion_count = board->GenerateEvasions(evasions);
+    EXPECT_LE(evasion_count, count);
+    std::vector<Bitmove> expected, got;
+    for (int n = 0; n < count; ++n) {
+      if (board->LeavesKingSafe(pseudo[n]))
+        expected.push_back(pseudo[n]);
+    }
+    for (int n = 0; n < evasion_count; ++n) {
+      if (board->LeavesKingSafe(evasions[n]))
+        got.push_back(evasions[n]);
+    }
+    auto order = [](Bitmove a, Bitmove b) { return a.bits() < b.bits(); };
+    std::sort(expected.begin(), expected.end(), order);
+    std::sort(got.begin(), got.end(), order);
+    ASSERT_EQ(expected, got) << *board;
+  });
+  EXPECT_LT(0, checks);
+}
+
+// Piece bitboards are kept up to date move by move, so they'd better still
+// match the squares after a long game and after taking everything back.
+static void ExpectPiecesMatchSquares(const Board& board) {
+  for (int n = 0; n < 64; ++n) {
+    Square square(n / kRow, n % kRow);
+    Piece piece = board.GetPiece(square);
+    for (int color = 0; color < kColors; ++color) {
+      for (int type = kPawn; type <= kKing; ++type) {
+        bool here = (!piece.IsEmpty() && piece.color() == color &&
+                     piece.piece() == type);
+        ASSERT_EQ(here, bool(board.pieces((Colors)color, (Pieces)type) &
+                             Bitboard(square)))
+            << board << square;
+      }
+    }
+  }
+}
+
+TEST(BoardTest, PieceBitboardsFollowMoves) {
+  std::srand(5);
+  ForEachRandomPosition(20, 100, [](Board* board, const MoveList& moves) {
+    for (const Bitmove& move : moves) {
+      Board::Undo undo;
+      board->MakeMove(move, &undo);
+      ExpectPiecesMatchSquares(*board);
+      board->UnmakeMove(move, undo);
+    }
+    ExpectPiecesMatchSquares(*board);
+  });
+}
+
+// Checkers come from AttackersOf(), so both ways of asking must agree.
+TEST(BoardTest, IsAttackedAgreesWithCheckers) {
+  std::srand(9);
+  int checks = 0;
+  ForEachRandomPosition(50, 120, [&checks](Board* board, const MoveList&) {
+    Square king = board->pieces(board->color(), kKing).PopSquare();
+    EXPECT_EQ(board->InCheck(),
+              board->IsAttacked(king, Toggle(board->color()))) << *board;
+    checks += board->InCheck();
+  });
+  EXPECT_LT(0, checks);
+}
@@ -1,6 +1,8 @@
 // bot.cc - primary chessy 'AI' logic implementation
 // 2013.02.09
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 #include <glog/logging.h>
@@ -9,59 +11,401 @@
 #include "bitmove.h"
 #include "board.h"
 #include "bot.h"
+#include "move.h"
 #include "render.h"
 #include "term.h"
+#include "transtable.h"
 
 using std::string;
 
 namespace chessy {
 
-int g_branches_searched = 0;
-int g_branches_pruned = 0;
+typedef std::chrono::steady_clock Clock;
+
+int64_t g_branches_searched = 0;
+int64_t g_branches_pruned = 0;
+int64_t g_nodes = 0;
+int64_t g_qnodes = 0;
+int64_t g_researches = 0;
+int64_t g_passes = 0;
+SearchAlgorithm g_search = kPvsSearch;
+
+// Quiescence skips captures that couldn't lift the score to alpha even if
+// the piece came for free, give or take this much positional slack.
+static const int kDeltaMargin = 2 * kCentipawn;
+
+static Clock::time_point g_start = Clock::now();
+static Clock::time_point g_deadline = Clock::time_point::max();
+static bool g_out_of_time = false;
+static int g_think_depth = 0;  // For indenting trace logs.
+
+// Quiet moves that caused a beta cutoff at each ply. Sibling positions tend
+// to be refuted by the same move.
+static Bitmove g_killers[kMaxDepth + 1][2];
 
 #define TLOG \
-  VLOG(2) << string((kMaxDepth - depth) * 2, ' ')
+  VLOG(2) << string((g_think_depth - depth) * 2, ' ')
 
-int Think(const Board& board) {
-  return -NegaMax(board, kMaxDepth, kMinScore, kMaxScore);
+void ResetCounters() {
+  g_branches_searched = 0;
+  g_branches_pruned = 0;
+  g_nodes = 0;
+  g_qnodes = 0;
+  g_researches = 0;
+  g_passes = 0;
 }
 
-// Maximizes the negation of the enemy player's positions.
-int NegaMax(const Board& board, int depth, int alpha, int beta) {
-  Bitmoves moves = board.PossibleMoves();
-  TLOG << moves.size()
-       << "-< (" << Toggle(board.color())
-       // << " "    << board.last_move()
-       << ") a[" << alpha
-       << "] b[" << beta
-       << "] >- ";
-  if (moves.size() == 0) {
-    TLOG << "h-val(" << board.color() << ")=" << kMaxScore;
-    return kMaxScore;
+void StartClock(double seconds) {
+  g_start = Clock::now();
+  g_deadline = g_start + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(seconds));
+  g_out_of_time = false;
+}
+
+void StopClock() {
+  g_out_of_time = true;
+}
+
+bool OutOfTime() {
+  return g_out_of_time;
+}
+
+double SecondsThinking() {
+  return std::chrono::duration<double>(Clock::now() - g_start).count();
+}
+
+const char* SearchAlgorithmName(SearchAlgorithm algorithm) {
+  switch (algorithm) {
+    case kMtdfSearch:      return "mtdf";
+    case kNegaCStarSearch: return "negacstar";
+    case kSssStarSearch:   return "sssstar";
+    case kDualStarSearch:  return "dualstar";
+    default:               return "pvs";
   }
-  if (depth == 0) {
-    int score = board.score();
-    TLOG << "h-val(" << board.color() << ")=" << score;
-    // TODO: Quiescent search if last_move_ is "exciting".
-    return score;
+}
+
+// Where null-window drivers start: whatever the last iteration found here,
+// or just the material if this position hasn't been seen.
+static int FirstGuess(Board* board) {
+  TransEntry entry;
+  if (g_transtable.Probe(board->Hash(), &entry)) {
+    return entry.score;
   }
-  g_branches_searched += moves.size();
+  return board->score();
+}
+
+// One null-window search of the root for the drivers below, counted and
+// logged. A pass that fails high proves its move scores at least |beta|, so
+// the last one to do so found the move that reaches the final score. The
+// root's table entry is the last thing the pass stores, so it's still there.
+static int Pass(Board* board, int depth, int beta, Bitmove* best) {
+  int64_t nodes = g_nodes + g_qnodes;
+  int score = NegaMax(board, depth, beta - 1, beta);
+  ++g_passes;
+  VLOG(2) << SearchAlgorithmName(g_search) << " depth " << depth
+          << " beta " << beta << " score " << score
+          << " nodes " << g_nodes + g_qnodes - nodes;
+  TransEntry entry;
+  if (score >= beta && !g_out_of_time &&
+      g_transtable.Probe(board->Hash(), &entry) && entry.move.IsValid()) {
+    *best = entry.move;
+  }
+  return score;
+}
+
+// MTD(f) homes in on the value with null-window searches alone. Each pass
+// says whether the value is above or below the guess, which moves one bound
+// to the score it failed with, and the transposition table remembers the
+// earlier passes so later ones are mostly lookups.
+static int Mtdf(Board* board, int depth, int guess, Bitmove* best) {
+  int lower = kMinScore;
+  int upper = kMaxScore;
+  while (lower < upper && !g_out_of_time) {
+    int beta = (guess == lower) ? guess + 1 : guess;
+    guess = Pass(board, depth, beta, best);
+    if (guess < beta) {
+      upper = guess;
+    } else {
+      lower = guess;
+    }
+  }
+  return guess;
+}
+
+// NegaC* needs no guess: it tests the middle of the bounds each pass, so it
+// settles in about log2 of their span. Fail-soft scores often move a bound
+// past the middle, which is what keeps it from taking the full count.
+static int NegaCStar(Board* board, int depth, Bitmove* best) {
+  int lower = kMinScore;
+  int upper = kMaxScore;
+  int score = 0;
+  while (lower < upper && !g_out_of_time) {
+    int gamma = lower + (upper - lower + 1) / 2;
+    score = Pass(board, depth, gamma, best);
+    if (score < gamma) {
+      upper = score;
+    } else {
+      lower = score;
+    }
+  }
+  return score;
+}
+
+int Think(Board* board, int depth, int alpha, int beta) {
+  g_think_depth = depth;
+  return -NegaMax(board, depth, -beta, -alpha);
+}
+
+// Scores every root move in turn. Here we directly track the "best move",
+// whereas the recursive internal algorithm focuses on improving "scores". The
+// root is searched the same way as the nodes below it though: the first move
+// with a full window, then null windows to show the others can't beat it,
+// searching in full only the ones that do.
+static int PvsRoot(Board* board, const MoveList& moves, int depth,
+                   Bitmove* best) {
+  // What a pessimist! Even if every move gets mated, one still has to be
+  // played.
+  int score = kMinScore;
+  *best = moves.front();
   for (const Bitmove& move : moves) {
-    int val = -NegaMax(Board(board, move), depth - 1, -beta, -alpha);
+    Board::Undo undo;
+    board->MakeMove(move, &undo);
+    int val;
+    if (&move == &moves.front()) {
+      val = Think(board, depth - 1, kMinScore, kMaxScore);
+    } else {
+      val = Think(board, depth - 1, score, score + 1);
+      if (val > score && !g_out_of_time) {
+        ++g_researches;
+        val = Think(board, depth - 1, score, kMaxScore);
+      }
+    }
+    board->UnmakeMove(move, undo);
+    if (g_out_of_time)
+      break;
+    if (val > score) {
+      score = val;
+      *best = move;
+      if (val == kMaxScore)  // Checkmate! <('.'<)
+        break;
+    }
+  }
+  return score;
+}
+
+// The null-window drivers search the root as a whole and say which move got
+// the score. A table collision could name some other move though.
+static int NullWindowRoot(Board* board, const MoveList& moves, int depth,
+                          Bitmove* best) {
+  *best = moves.front();
+  int score;
+  switch (g_search) {
+    case kMtdfSearch:
+      score = Mtdf(board, depth, FirstGuess(board), best);
+      break;
+    case kNegaCStarSearch:
+      score = NegaCStar(board, depth, best);
+      break;
+    // SSS* and Dual* are best-first: they keep every open line of the tree
+    // in memory and expand the most promising one. Run as MTD(f) from one
+    // end of the scale, the table plays that part, so they visit the same
+    // leaves without a memory cost beyond --hash_mb. Whatever doesn't fit
+    // just gets searched again.
+    case kSssStarSearch:
+      score = Mtdf(board, depth, kMaxScore, best);
+      break;
+    default:  // kDualStarSearch
+      score = Mtdf(board, depth, kMinScore, best);
+      break;
+  }
+  if (std::find(moves.begin(), moves.end(), *best) == moves.end())
+    *best = moves.front();
+  return score;
+}
+
+int SearchRoot(Board* board, const MoveList& moves, int depth,
+               Bitmove* best) {
+  g_think_depth = depth;
+  if (g_search == kPvsSearch)
+    return PvsRoot(board, moves, depth, best);
+  return NullWindowRoot(board, moves, depth, best);
+}
+
+// Reading the clock isn't free, so only look every so often.
+static inline void CheckClock() {
+  if ((g_nodes + g_qnodes) % kClockInterval == 0 &&
+      Clock::now() >= g_deadline) {
+    g_out_of_time = true;
+  }
+}
+
+template <Colors kUs>
+static int Quiesce(Board* board, int alpha, int beta);
+
+// Maximizes the negation of the enemy player's positions. kUs is the side to
+// move, which flips every ply, so it's known at compile time all the way down.
+// Moves after the first get a null window first; see g_researches.
+template <Colors kUs>
+static int NegaMax(Board* board, int depth, int alpha, int beta) {
+  ++g_nodes;
+  CheckClock();
+  if (g_out_of_time) {
+    return 0;
+  }
+  // A transposition may already have been searched deep enough to settle
+  // this node, or at least have left behind a good move to try first.
+  TransEntry entry;
+  Bitmove hash_move;
+  if (g_transtable.Probe(board->Hash(), &entry)) {
+    hash_move = entry.move;
+    if (entry.depth >= depth &&
+        (entry.bound() == kBoundExact ||
+         (entry.bound() == kBoundLower && entry.score >= beta) ||
+         (entry.bound() == kBoundUpper && entry.score <= alpha))) {
+      TLOG << "tt-hit(" << board->color() << ")=" << entry.score;
+      return entry.score;
+    }
+  }
+  if (depth == 0) {
+    return Quiesce<kUs>(board, alpha, beta);
+  }
+  TLOG << "-< (" << Toggle(board->color())
+       << ") a[" << alpha
+       << "] b[" << beta
+       << "] >- ";
+  int ply = g_think_depth - depth;
+  Bitmove* killers = g_killers[ply];
+  MovePicker<kUs> picker(board, hash_move, killers);
+  int original_alpha = alpha;
+  int searched = 0;
+  int best_score = kMinScore;
+  Bitmove best;
+  Bitmove move;
+  while (picker.Next(&move)) {
+    ++searched;
+    ++g_branches_searched;
+    bool quiet = board->IsQuiet(move);
+    g_transtable.Prefetch(board->HashAfter<kUs>(move));
+    Board::Undo undo;
+    board->MakeMove<kUs>(move, &undo);
+    int val;
+    if (searched == 1) {
+      val = -NegaMax<Toggle(kUs)>(board, depth - 1, -beta, -alpha);
+    } else {
+      // Principal variation search: the first move is probably best, so
+      // only prove the rest can't beat it, which a null window does cheaply.
+      // If one does, search it again to find out by how much.
+      val = -NegaMax<Toggle(kUs)>(board, depth - 1, -alpha - 1, -alpha);
+      if (val > alpha && val < beta && !g_out_of_time) {
+        ++g_researches;
+        val = -NegaMax<Toggle(kUs)>(board, depth - 1, -beta, -alpha);
+      }
+    }
+    board->UnmakeMove<kUs>(move, undo);
+    if (g_out_of_time) {
+      return 0;  // Don't let a cut-off search pollute the table.
+    }
     // Beta pruning skips remaining branches, because the current sub-tree is
     // now guaranteed to be futile (at least within the current depth).
     if (val >= beta) {
-      g_branches_pruned += moves.size();
-      TLOG << "<-- b-pruned(" << board.color() << ")=" << beta;
+      ++g_branches_pruned;
+      if (quiet) {
+        if (killers[0] != move) {
+          killers[1] = killers[0];
+          killers[0] = move;
+        }
+        g_history[move.from_to()] += depth * depth;
+      }
+      g_transtable.Store(board->Hash(), depth, val, kBoundLower, move);
+      TLOG << "<-- b-pruned(" << board->color() << ")=" << beta;
+      return val;
+    }
+    // Alpha just maximizes the negation of the next moves. A null window
+    // only says a move is no better than alpha, so a tie isn't a new best.
+    if (val > best_score) {
+      best_score = val;
+      if (val > alpha) {
+        alpha = val;
+        best = move;
+      }
+    }
+  }
+  if (searched == 0) {
+    // Checkmated, or stalemated which is a draw.
+    int val = board->InCheck() ? kMinScore : 0;
+    TLOG << "h-val(" << board->color() << ")=" << val;
+    return val;
+  }
+  // Fail-soft: below alpha, the best score seen is a tighter upper bound
+  // than alpha itself, which lets drivers like MTD(f) take bigger steps.
+  g_transtable.Store(board->Hash(), depth, best_score,
+                     (alpha > original_alpha) ? kBoundExact : kBoundUpper,
+                     best);
+  TLOG << "<--- a-negamaxed(" << board->color() << ")=" << best_score;
+  return best_score;
+}
+
+// Plays out captures until the position is quiet, so leaves aren't scored in
+// the middle of an exchange. Either side may "stand pat" and decline to
+// capture, so the static score is a lower bound.
+template <Colors kUs>
+static int Quiesce(Board* board, int alpha, int beta) {
+  ++g_qnodes;
+  CheckClock();
+  if (g_out_of_time) {
+    return 0;
+  }
+  int stand_pat = board->score();
+  if (stand_pat >= beta) {
+    return stand_pat;
+  }
+  if (stand_pat > alpha) {
+    alpha = stand_pat;
+  }
+  int best_score = stand_pat;
+  MoveList captures = board->PossibleCaptures<kUs>();
+  std::sort(captures.begin(), captures.end(),
+            [board](const Bitmove& a, const Bitmove& b) {
+              return board->CaptureOrder(a) > board->CaptureOrder(b);
+            });
+  for (const Bitmove& move : captures) {
+    // Delta pruning. CaptureOrder() puts the biggest CaptureGain() first, the
+    // same gain hope is made of, so nothing after this one can do any better.
+    // That much is still possible though, so it's as far as the bound can
+    // come down.
+    int hope = stand_pat + board->CaptureGain(move) + kDeltaMargin;
+    if (hope <= alpha) {
+      best_score = std::max(best_score, hope);
+      break;
+    }
+    Board::Undo undo;
+    board->MakeMove<kUs>(move, &undo);
+    int val = -Quiesce<Toggle(kUs)>(board, -beta, -alpha);
+    board->UnmakeMove<kUs>(move, undo);
+    if (g_out_of_time) {
+      return 0;
+    }
+    if (val >= beta) {
       return val;
     }
-    // Alpha just maximizes the negation of the next moves.
-    if (val >= alpha) {
-      alpha = val;
+    if (val > best_score) {
+      best_score = val;
+      alpha = std::max(alpha, val);
     }
   }
-  TLOG << "<--- a-negamaxed(" << board.color() << ")=" << alpha;
-  return alpha;
+  return best_score;
+}
+
+int NegaMax(Board* board, int depth, int alpha, int beta) {
+  return ((board->color() == kWhite) ?
+          NegaMax<kWhite>(board, depth, alpha, beta) :
+          NegaMax<kBlack>(board, depth, alpha, beta));
+}
+
+int Quiesce(Board* board, int alpha, int beta) {
+  return ((board->color() == kWhite) ?
+          Quiesce<kWhite>(board, alpha, beta) :
+          Quiesce<kBlack>(board, alpha, beta));
 }
 
 }  // namespace chessy
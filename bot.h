@@ -4,31 +4,64 @@
 #ifndef CHESSY_BOT_H_
 #define CHESSY_BOT_H_
 
+#include <cstdint>
+
 namespace chessy {
 
+class Bitmove;
 class Board;
+class MoveList;
 
-const int kMaxDepth = 2;
+const int kMaxDepth = 64;  // Iterative deepening stops here if time allows.
 const int kMinScore = -99999;
 const int kMaxScore = 99999;
 const int kMaxThinkTime = 5;  // seconds
+const int kClockInterval = 4096;  // Nodes searched between clock checks.
+
+// Search statistics, for one move at a time; see ResetCounters().
+extern int64_t g_branches_searched;  // Moves tried by NegaMax().
+extern int64_t g_branches_pruned;  // Beta cutoffs in NegaMax().
+extern int64_t g_nodes;  // Calls to NegaMax().
+extern int64_t g_qnodes;  // Calls to Quiesce().
+extern int64_t g_researches;  // Null-window scouts that failed high.
+extern int64_t g_passes;  // Null-window searches made by the drivers.
+
+void ResetCounters();  // Zeroes all of the above.
+
+// How SearchRoot() goes about it. They all share NegaMax(), the transposition
+// table and move ordering, and differ in the windows they ask for.
+enum SearchAlgorithm {
+  kPvsSearch,        // One full window, with PVS inside NegaMax().
+  kMtdfSearch,       // Null windows only, closing in from a first guess.
+  kNegaCStarSearch,  // Null windows only, bisecting the bounds.
+  kSssStarSearch,    // SSS*: MTD(f) guessing the best possible score.
+  kDualStarSearch,   // Dual*: MTD(f) guessing the worst possible score.
+};
 
-extern int g_branches_searched;
-extern int g_branches_pruned;
+extern SearchAlgorithm g_search;  // kPvsSearch unless changed.
+const char* SearchAlgorithmName(SearchAlgorithm algorithm);
 
-int Think(const Board& board);
-int NegaMax(const Board& board, int depth, int alpha, int beta);
+// Starts the think time budget. Once it runs out OutOfTime() becomes true
+// and searches in progress unwind quickly with meaningless scores.
+void StartClock(double seconds);
+void StopClock();  // Runs out the time now, e.g. when the game is stopped.
+bool OutOfTime();
+double SecondsThinking();
 
-// TODO: Once there are multiple algorithms, run tests to determine the
-// efficacy of each, and possibly interchange different algorithms for
-// different situations.
+// All leave |board| as they found it. Think() scores |board| for the player
+// who just moved onto it, within their own |alpha| and |beta|, so a root
+// loop can pass down the best score it has so far.
+int Think(Board* board, int depth, int alpha, int beta);
+// Searches |board| itself with g_search, for the player to move, and sets
+// |best| to the move that gets the score. |moves| are the legal moves of
+// |board|, most promising first, and |best| is always one of them. This is
+// the search the game plays its moves with.
+int SearchRoot(Board* board, const MoveList& moves, int depth, Bitmove* best);
+int NegaMax(Board* board, int depth, int alpha, int beta);
+int Quiesce(Board* board, int alpha, int beta);
 
-// These algorithms could be fun:
-// - NegaScout
-// - NegaC*
-// - MTD(f)
-// - SSS*
-// - Dual*
+// TODO: Run tests to determine the efficacy of each algorithm, and possibly
+// interchange different algorithms for different situations.
 
 }  // namespace chessy
 
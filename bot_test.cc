@@ -0,0 +1,105 @@
+#include "bot.h"
+#include "board.h"
+#include "transtable.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <gtest/gtest.h>
+
+using namespace chessy;
+
+// Counts every allocation made by the test binary, so a test can check that
+// some stretch of code made none.
+static long g_allocations = 0;
+
+void* operator new(size_t size) {
+  ++g_allocations;
+  void* res = malloc(size ? size : 1);
+  if (!res)
+    throw std::bad_alloc();
+  return res;
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+static void Play(Board* board, const char* source, const char* dest) {
+  const Bitmove& move = board->ComposeMove(source, dest);
+  ASSERT_TRUE(move.IsValid()) << source << dest;
+  *board = Board(*board, move);
+}
+
+TEST(BotTest, SearchDoesNotAllocate) {
+  Board board;
+  Play(&board, "e2", "e4");
+  Play(&board, "d7", "d5");  // Some captures for quiescence to look at.
+  g_transtable.NewSearch();
+  StartClock(60);
+  long before = g_allocations;
+  for (int depth = 1; depth <= 4; ++depth) {
+    Think(&board, depth, kMinScore, kMaxScore);
+  }
+  EXPECT_EQ(before, g_allocations);
+  EXPECT_FALSE(OutOfTime());
+}
+
+// Every algorithm finds the same value; they only differ in how much of the
+// tree they look at to prove it. The reference is PVS, the search ChessyMove()
+// plays with. The table is cleared in between so no algorithm can borrow
+// another's results.
+static void ExpectAlgorithmsAgree() {
+  const char* kFens[] = {
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  };
+  StartClock(60);
+  for (const char* fen : kFens) {
+    Board board;
+    ASSERT_TRUE(board.LoadFen(fen));
+    MoveList moves = board.PossibleMoves();
+    g_search = kPvsSearch;
+    g_transtable.Clear();
+    Bitmove expected_best;
+    int expected = SearchRoot(&board, moves, 3, &expected_best);
+    for (SearchAlgorithm algorithm : {kPvsSearch, kMtdfSearch,
+                                      kNegaCStarSearch, kSssStarSearch,
+                                      kDualStarSearch}) {
+      g_search = algorithm;
+      g_transtable.Clear();
+      Bitmove best;
+      int score = SearchRoot(&board, moves, 3, &best);
+      EXPECT_EQ(expected, score)
+          << fen << " " << SearchAlgorithmName(algorithm);
+      if (algorithm == kPvsSearch) {
+        EXPECT_EQ(expected_best, best) << fen;
+      }
+      // The move found has to be legal and actually get that score.
+      ASSERT_NE(moves.end(), std::find(moves.begin(), moves.end(), best))
+          << fen << " " << SearchAlgorithmName(algorithm);
+      Board child(board, best);
+      g_transtable.Clear();
+      EXPECT_EQ(score, Think(&child, 2, kMinScore, kMaxScore))
+          << fen << " " << SearchAlgorithmName(algorithm) << " " << best;
+    }
+  }
+  g_search = kPvsSearch;
+  EXPECT_FALSE(OutOfTime());
+}
+
+TEST(BotTest, AlgorithmsAgree) {
+  ExpectAlgorithmsAgree();
+}
+
+// With a single cluster every key collides, so the null-window drivers lose
+// most of what earlier passes learned. They have to get there anyway.
+TEST(BotTest, AlgorithmsAgreeWithTinyTable) {
+  g_transtable.Resize(0);
+  ExpectAlgorithmsAgree();
+  g_transtable.Resize(16);
+}
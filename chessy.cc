@@ -3,6 +3,7 @@
 
 #include "chessy.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <ctime>
 #include <iostream>
@@ -12,9 +13,11 @@
 
 #include "board.h"
 #include "bot.h"
+#include "move.h"
 #include "render.h"
 #include "square.h"
 #include "term.h"
+#include "transtable.h"
 
 using std::cout;
 using std::endl;
@@ -25,6 +28,9 @@ namespace chessy {
 const string kChessyHappy = term::kGreen + "Q(^_^ Q)";
 const string kChessySad = term::kRed + u8"\u00F7(-_- \u00F7)";
 
+int g_think_time = kMaxThinkTime;
+bool g_show_thinking = true;
+
 static GameMode g_mode = kMirror;
 static GameState g_state = kNone;
 
@@ -38,6 +44,8 @@ static void Chillax(int ms) {
 }
 
 static void ChessyBeginsThinking(const Board& board, int branches) {
+  if (!g_show_thinking)
+    return;
   // BLACK chessy msgs on top, WHITE chessy msgs on bottom.
   if (kBlack == board.color()) {
     render::ChessyNewMsg("BLACK THOUGHTS~");
@@ -45,24 +53,33 @@ static void ChessyBeginsThinking(const Board& board, int branches) {
     render::ChessyNewMsgMirror("WHITE THOUGHTS~");
   }
   render::ChessyMsg(  // Basic metrics.
-      "  |d|="    + term::i2s(kMaxDepth) +
+      "  |t|="    + term::i2s(g_think_time) + "s" +
       "  |M|="    + term::i2s(branches) +
       "  |eval|=" + term::i2s(board.score()) +
       "\n\t" + term::kPink + u8"\u00A7");  // Begin progress bar.
 }
 
-static void NewBest(int score, const Bitmove& move) {
+static void NewBest(int depth, int score, const Bitmove& move,
+                    int64_t nodes, double seconds) {
+  VLOG(1) << "depth " << depth << " best " << move << " score " << score
+          << " nodes " << nodes << " seconds " << seconds;
+  if (!g_show_thinking)
+    return;
   string hval = (score >= 0 ?  // GREEN+ RED-
                  term::kGreen + "+" :
                  term::kRed) + term::i2s(score);
   render::ChessyMsg("{" + hval + term::kPink + "}");
   // Further |move| detail
   render::ChessyMsg(
-      "Best move thus far: " + move.ToString() +
-      " (s-val=" + term::i2s(score) + ")\n\t");
+      "Best move at |d|=" + term::i2s(depth) + ": " + move.ToString() +
+      " (s-val=" + term::i2s(score) +
+      ", nodes=" + term::i2s(nodes) +
+      ", ms=" + term::i2s(seconds * 1000) + ")\n\t");
 }
 
 static void ChessyProgress() {
+  if (!g_show_thinking)
+    return;
   if (kHuman == g_mode)  // Slow down for stupid humans.
     Chillax(1);
   render::ChessyMsg(u8"\u00BB");  // Indicator
@@ -70,39 +87,83 @@ static void ChessyProgress() {
 }
 
 static void ChessyFinishesThinking(int score) {
+  if (!g_show_thinking)
+    return;
   // Chessy has happy metrics!
-  float savings = static_cast<float>(g_branches_pruned) /
-                  static_cast<float>(g_branches_searched) * 100;
+  float savings = ((g_branches_searched > 0) ?
+                   static_cast<float>(g_branches_pruned) /
+                   static_cast<float>(g_branches_searched) * 100 : 0);
+  float hit_rate = ((g_transtable.probes() > 0) ?
+                    static_cast<float>(g_transtable.hits()) /
+                    static_cast<float>(g_transtable.probes()) * 100 : 0);
   const string& face = (score >= 0) ? kChessyHappy : kChessySad;
   render::ChessyMsg(
       u8"\u00A7 " + face + term::kPink +
       "\n\t\t total branches: " + term::i2s(g_branches_searched) +
       "\n\t\t total pruned:   " + term::i2s(g_branches_pruned) +
-      "\n\t\t search savings: " + term::i2s(savings) + "%");
+      "\n\t\t cutoff rate:    " + term::i2s(savings) + "%" +
+      "\n\t\t re-searches:    " + term::i2s(g_researches) +
+      ((g_passes > 0) ?
+       "\n\t\t " + string(SearchAlgorithmName(g_search)) + " passes: " +
+       term::i2s(g_passes) +
+       "\n\t\t nodes per pass: " +
+       term::i2s((g_nodes + g_qnodes) / g_passes) : "") +
+      "\n\t\t quiesce nodes:  " + term::i2s(g_qnodes) +
+      "\n\t\t tt hit rate:    " + term::i2s(hit_rate) + "%" +
+      "\n\t\t tt fill:        " + term::i2s(g_transtable.Fill() / 10) + "%");
 }
 
-static Bitmove ChessyMove(const Board& board, const Bitmoves& moves) {
-  int score = kMinScore;  // What a pessimist!
-  Bitmove best = Bitmove::kInvalid;
-  ChessyBeginsThinking(board, moves.size());
-  for (const auto& move : moves) {
-    // Root-level move selection is AGNOSTIC to the internal algorithm.
-    // Here we directly track the "best move", whereas the recursive internal
-    // algorithm focuses on improving "scores" by neurotically branching and
-    // verifying a-b windows as much as possible.
-    int val = Think(Board(board, move));
-    if (val > score) {
-      score = val;
-      best = move;
-      NewBest(score, move);
-      if (val == kMaxScore) {  // Checkmate! <('.'<)
-        break;
-      }
+// Scores the root |depth| plies deep. Returns false if time ran out or the
+// game was interrupted before the search finished.
+static bool ChessyIteration(Board* board, const MoveList& moves, int depth,
+                            int* score, Bitmove* best) {
+  *score = SearchRoot(board, moves, depth, best);
+  ChessyProgress();
+  return !OutOfTime() && kPlaying == g_state;
+}
+
+Bitmove ChessyMove(Board* board, const MoveList& root_moves) {
+  g_transtable.NewSearch();
+  AgeHistory();
+  ResetCounters();  // So the report afterwards is about this move alone.
+  StartClock(g_think_time);
+  // Try first whatever an earlier search thought was best here.
+  TransEntry entry;
+  MoveList moves = root_moves;
+  if (g_transtable.Probe(board->Hash(), &entry)) {
+    PutFirst(entry.move, &moves);
+  }
+  ChessyBeginsThinking(*board, moves.size());
+  // Search one ply deeper each time until the clock runs out. An iteration
+  // that gets cut off is thrown away, so the move played always comes from
+  // the deepest search that finished.
+  int score = kMinScore;
+  Bitmove best = moves.front();
+  for (int depth = 1; depth <= kMaxDepth; ++depth) {
+    int64_t nodes = g_nodes + g_qnodes;
+    double seconds = SecondsThinking();
+    int iteration_score;
+    Bitmove iteration_best;
+    if (!ChessyIteration(board, moves, depth,
+                         &iteration_score, &iteration_best)) {
+      break;
     }
-    ChessyProgress();  // (maybe) track root progress
-    if (kPlaying != g_state)  // Breaking out early
-      return best;
+    score = iteration_score;
+    if (iteration_best.IsValid())
+      best = iteration_best;
+    NewBest(depth, score, best, g_nodes + g_qnodes - nodes,
+            SecondsThinking() - seconds);
+    // Each new best root move was searched with a full window, so the score
+    // is exact unless a mate cut the loop short.
+    g_transtable.Store(board->Hash(), depth, score,
+                       (score == kMaxScore) ? kBoundLower : kBoundExact,
+                       best);
+    PutFirst(best, &moves);
+    if (score == kMaxScore)
+      break;
   }
+  if (kPlaying != g_state)  // Breaking out early
+    return best;
   ChessyFinishesThinking(score);
   return best;
 }
@@ -116,7 +177,7 @@ static bool ValidateNotation(const string& input,
   return (source->IsValid() && dest->IsValid());
 }
 
-static const Bitmove& HumanMove(const Board& board, const Bitmoves& moves) {
+static Bitmove HumanMove(const Board& board, const MoveList& moves) {
   string input;
   while (kPlaying == g_state) {
     input = render::HumanMovePrompt();
@@ -133,7 +194,7 @@ static const Bitmove& HumanMove(const Board& board, const Bitmoves& moves) {
       render::Status("Smith notation please. (Example: a1b2)");
       continue;
     }
-    const Bitmove& move = board.ComposeMove(source, dest);
+    Bitmove move = board.ComposeMove(source, dest);
     if (move.IsValid()) {
       render::Status("You moved:  ");
       return move;
@@ -151,6 +212,7 @@ void EndGame() {
     //fflush(stdin);
     render::Status("Game interrupted!");
     g_state = kNone;
+    StopClock();  // Don't finish thinking about a move nobody will play.
     return;
   }
   // Or the entire program.
@@ -160,6 +222,11 @@ void EndGame() {
   exit(0);
 }
 
+void StartGame(GameMode mode) {
+  g_mode = mode;
+  g_state = kPlaying;
+}
+
 static void DetermineGameType() {
   static int games_started = 0;
   string prompt = "How about a nice game of chess?";
@@ -167,19 +234,18 @@ static void DetermineGameType() {
   if (games_started > 0) {
     prompt = "Shall we rematch?";
   }
+  GameMode mode = kMirror;
   if (render::YesNoPrompt(prompt)) {
-    g_mode = kHuman;
+    mode = kHuman;
     render::Status("You are WHITE and Chessy is BLACK.");
   } else {
     render::ChessyNewMsg("Alrighty. How about a lovely ");
-    if (render::YesNoPrompt("2-chessy 1-board demonstration?")) {
-      g_mode = kMirror;
-    } else {
+    if (!render::YesNoPrompt("2-chessy 1-board demonstration?")) {
       EndGame();
     }
   }
   games_started++;
-  g_state = kPlaying;  // Let the games begin!
+  StartGame(mode);  // Let the games begin!
 }
 
 void GameLoop() {
@@ -204,9 +270,9 @@ void GameLoop() {
     }
 
     while (kPlaying == g_state) {
-      Bitmoves moves = board.PossibleMoves();
+      MoveList moves = board.PossibleMoves();
       if (moves.size() == 0) {
-        render::Status("Checkmate <3");
+        render::Status(board.InCheck() ? "Checkmate <3" : "Stalemate");
         break;
       }
       Bitmove move;
@@ -218,21 +284,20 @@ void GameLoop() {
         }
         CHECK(move.IsValid());  // No cheating, dear.
       } else {
-        move = ChessyMove(board, moves);
+        move = ChessyMove(&board, moves);
         render::ChessyMsg("\n\n\t Result:  ");
       }
 
       // Resultant move will print at the current cursor position, which is
       // set from above as either for the Human or for Chessy.
-      string move_str = (board.GetPiece(move.source).Describe() + " " +
+      string move_str = (board.GetPiece(move.source()).Describe() + " " +
                          move.ToString());
       cout << move_str;
 
       board = Board(board, move);  // ph0 realz
       render::UpdateBoard(board, move);
 
-      // TODO: Make this not suck.
-      if (board.IsChecking()) {
+      if (board.InCheck()) {
         cout << endl << "CHECK!" << endl;
       }
 
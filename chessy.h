@@ -6,8 +6,12 @@
 
 #include <string>
 
+#include "bitmove.h"
+
 namespace chessy {
 
+class Board;
+
 enum GameMode {
   kMirror = 0,  // Bot plays itself.
   kHuman = 1,  // Bot plays YOU!
@@ -22,6 +26,20 @@ enum GameState {
 // Play the game.
 void GameLoop();
 
+// Starts a game without asking, so Chessy's moves can be played.
+void StartGame(GameMode mode);
+
+// How many seconds ChessyMove() thinks for. kMaxThinkTime unless changed.
+extern int g_think_time;
+
+// Whether ChessyMove() draws its thinking on the terminal. True unless
+// changed.
+extern bool g_show_thinking;
+
+// Chessy thinks for a while and picks one of |moves|, the legal moves on
+// |board|. Once the game is stopped it gives up early with its best so far.
+Bitmove ChessyMove(Board* board, const MoveList& moves);
+
 // Stop the game loop (usually from a signal handler).
 void EndGame();
 
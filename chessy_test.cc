@@ -0,0 +1,27 @@
+#include "chessy.h"
+#include "board.h"
+#include "bot.h"
+#include "transtable.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+
+using namespace chessy;
+
+// Every move loses to mate, so none ever beats the starting score. Chessy
+// still has to play one of them rather than nothing at all.
+TEST(ChessyTest, MovesWhenMated) {
+  Board board;
+  ASSERT_TRUE(board.LoadFen("7k/8/5QK1/8/8/8/8/8 b - - 0 1"));
+  MoveList moves = board.PossibleMoves();
+  ASSERT_FALSE(moves.empty());
+  g_transtable.Clear();
+  StartGame(kMirror);
+  g_think_time = 1;  // Nothing deeper will find a way out.
+  g_show_thinking = false;  // Keep the terminal art out of the test log.
+  Bitmove move = ChessyMove(&board, moves);
+  g_think_time = kMaxThinkTime;
+  g_show_thinking = true;
+  EXPECT_TRUE(move.IsValid());
+  EXPECT_TRUE(board.IsLegal(move, true)) << move;
+  EXPECT_NE(moves.end(), std::find(moves.begin(), moves.end(), move)) << move;
+}
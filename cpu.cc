@@ -0,0 +1,58 @@
+// cpu.cc - what the processor we're running on can do
+
+#include "cpu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace chessy {
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Static constructors may get here before the runtime has run CPUID, so ask
+// it to first. It's cheap and only does the work once.
+bool HasBmi2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2");
+}
+
+bool HasAvx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+// Zen 3 is family 0x19. The family in CPUID leaf 1 only adds the extended
+// field once the base one is maxed out at 0xf, which AMD's always is.
+bool HasFastPext() {
+  if (!HasBmi2())
+    return false;
+  if (!__builtin_cpu_is("amd"))
+    return true;
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return false;
+  unsigned family = (eax >> 8) & 0xf;
+  if (family == 0xf)
+    family += (eax >> 20) & 0xff;
+  return family >= 0x19;
+}
+
+#else
+
+bool HasBmi2() { return false; }
+bool HasAvx2() { return false; }
+bool HasFastPext() { return false; }
+
+#endif
+
+std::string CpuFeatures() {
+  std::string res;
+  if (HasBmi2())
+    res += " bmi2";
+  if (HasAvx2())
+    res += " avx2";
+  return res.empty() ? "baseline" : res.substr(1);
+}
+
+}  // namespace chessy
@@ -0,0 +1,25 @@
+// cpu.h - what the processor we're running on can do
+
+#ifndef CHESSY_CPU_H_
+#define CHESSY_CPU_H_
+
+#include <string>
+
+namespace chessy {
+
+// One binary runs across machines of different ages, so anything beyond
+// baseline x86-64 is compiled into separate functions and only called once
+// CPUID says the instructions exist. Always false on other architectures.
+bool HasBmi2();  // PEXT.
+bool HasAvx2();
+
+// AMD before Zen 3 has BMI2, but runs PEXT in microcode over dozens of
+// cycles, which is slower than the multiply it's meant to replace.
+bool HasFastPext();
+
+// The extensions found, like "bmi2 avx2", or "baseline".
+std::string CpuFeatures();
+
+}  // namespace chessy
+
+#endif  // CHESSY_CPU_H_
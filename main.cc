@@ -1,19 +1,42 @@
 // chessy - a chess engine by justine and serene
 // February 3rd, 2013
 
+#include <algorithm>
+#include <chrono>
 #include <ctime>
+#include <iomanip>
 #include <signal.h>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "attacks.h"
 #include "bitmove.h"
 #include "bitboard.h"
 #include "board.h"
+#include "bot.h"
 #include "chessy.h"
+#include "cpu.h"
+#include "perft.h"
 #include "square.h"
 #include "term.h"
+#include "transtable.h"
+
+DEFINE_int32(hash_mb, 16, "Transposition table size in megabytes.");
+DEFINE_int32(perft, 0, "Count move paths this many plies deep and exit.");
+DEFINE_string(fen, "", "Position for --perft in FEN, instead of the opening.");
+DEFINE_int32(perft_threads, 0, "Workers for --perft, or 0 for one per core.");
+DEFINE_int32(perft_hash_mb, 0, "Perft cache size in megabytes, or 0 for none.");
+DEFINE_string(search, "pvs", "Search algorithm: principal variation search "
+              "(pvs), MTD(f) (mtdf), NegaC* (negacstar), SSS* (sssstar) or "
+              "Dual* (dualstar).");
+DEFINE_string(sliders, "auto", "Slider attacks from magic tables (magic), "
+              "PEXT-indexed tables (pext), Kogge-Stone fills (kogge-stone), "
+              "or whichever suits this CPU best (auto).");
 
 using std::cout;
 using std::endl;
@@ -21,19 +44,108 @@ using std::string;
 
 using namespace chessy;
 
+// Table sizes past this are more likely a typo than a machine that has it.
+static const int kMaxHashMb = 1 << 16;
+
+// Reads --sliders, refusing backends this CPU can't run.
+static bool ParseSliders(const string& name, SliderBackend* backend) {
+  if (name == "auto") {
+    *backend = BestSliderBackend();
+    return true;
+  }
+  for (SliderBackend b : {kMagicSliders, kPextSliders, kKoggeStoneSliders}) {
+    if (name == SliderBackendName(b) && IsSupported(b)) {
+      *backend = b;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseSearch(const string& name, SearchAlgorithm* algorithm) {
+  for (SearchAlgorithm a : {kPvsSearch, kMtdfSearch, kNegaCStarSearch,
+                            kSssStarSearch, kDualStarSearch}) {
+    if (name == SearchAlgorithmName(a)) {
+      *algorithm = a;
+      return true;
+    }
+  }
+  return false;
+}
+
 static void OnQuit(int sig) {
   EndGame();
 }
 
+// Prints the count under each root move, then the total and how fast.
+static int RunPerft() {
+  Board board;
+  if (!FLAGS_fen.empty() && !board.LoadFen(FLAGS_fen)) {
+    std::cerr << "bad fen: " << FLAGS_fen << endl;
+    return 1;
+  }
+  int threads = FLAGS_perft_threads;
+  if (threads <= 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  std::unique_ptr<PerftTable> table;
+  if (FLAGS_perft_hash_mb > 0)
+    table.reset(new PerftTable(FLAGS_perft_hash_mb));
+  auto start = std::chrono::steady_clock::now();
+  std::vector<PerftDivision> division =
+      Divide(board, FLAGS_perft, threads, table.get());
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  uint64_t nodes = 0;
+  for (const PerftDivision& root : division) {
+    cout << root.move << ": " << root.nodes << endl;
+    nodes += root.nodes;
+  }
+  double seconds = elapsed.count();
+  cout << endl
+       << "Moves: " << division.size() << endl
+       << "Nodes: " << nodes << endl
+       << "Time:  " << seconds << "s" << endl;
+  // A tiny perft can finish within one tick of the clock.
+  if (seconds > 0) {
+    cout << "NPS:   " << std::fixed << std::setprecision(0)
+         << nodes / seconds << endl;
+  }
+  return 0;
+}
+
 int main(int argc, char** argv) {
   google::SetUsageMessage("chessy [FLAGS]");
-  google::SetVersionString("0.1");
-  google::ParseCommandLineFlags(&argc, &argv, true);
+  // --version should say which code paths this host ends up on, which
+  // depends on the other flags, so it's handled after them.
+  google::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+  SliderBackend sliders;
+  if (!ParseSliders(FLAGS_sliders, &sliders)) {
+    std::cerr << "bad --sliders for this cpu: " << FLAGS_sliders << endl;
+    return 1;
+  }
+  if (FLAGS_hash_mb <= 0 || FLAGS_hash_mb > kMaxHashMb) {
+    std::cerr << "--hash_mb must be 1 to " << kMaxHashMb << endl;
+    return 1;
+  }
+  if (FLAGS_perft_hash_mb > kMaxHashMb) {
+    std::cerr << "--perft_hash_mb must be at most " << kMaxHashMb << endl;
+    return 1;
+  }
+  if (!ParseSearch(FLAGS_search, &g_search)) {
+    std::cerr << "bad --search: " << FLAGS_search << endl;
+    return 1;
+  }
+  google::SetVersionString(string("0.1 (cpu: ") + CpuFeatures() +
+                           ", sliders: " + SliderBackendName(sliders) + ")");
+  google::HandleCommandLineHelpFlags();
   google::InitGoogleLogging(argv[0]);
   google::InstallFailureSignalHandler();
   std::srand(static_cast<unsigned>(std::time(0)));
   signal(SIGINT, &OnQuit);
-  InitBitmoves();
+  InitBitmoves(sliders);
+  if (FLAGS_perft > 0)
+    return RunPerft();
+  g_transtable.Resize(FLAGS_hash_mb);
 
   // Board board;
   // board = Board(board, board.ComposeMove("e2", "e4"));
@@ -1,76 +1,192 @@
-// move.h - move representation
+// move.cc - move ordering
 // 2013.02.08
 
 #include "move.h"
 
-#include "board.h"
+#include <utility>
+
+#include <glog/logging.h>
 
-using std::string;
+#include "board.h"
 
 namespace chessy {
 
-const std::array<string, kMoveTypes> kMoves = {{
-  "Invalid",
-  "Regular",
-  "Capture",
-  "Castle",
-  "Queen-side Castle",
-  "Check",
-  "NullMove",
-  "Tentative",
-}};
-
-Move::Move(MoveType type, Square source, Square dest, Piece captured)
-    : source(source), dest(dest),
-      type(type), captured(captured),
-      priority(kPieceValues[captured]) {}
-
-bool CompareMoves(const Move& a, const Move& b) {
-  if (a.priority == b.priority) {
-    return std::rand() % 2 == 0;
-  } else {
-    return a.priority < b.priority;
+int g_history[1 << 12];
+
+// Puts evasions that capture or promote ahead of any quiet one's history
+// score.
+static const int kCaptureBonus = 1 << 28;
+
+void AgeHistory() {
+  for (int& score : g_history) {
+    score /= 2;
   }
 }
 
-void AddMove(Moves* moves, const Move& move) {
-  //  cout << "Adding move " << move << endl;
-  moves->push_back(move);
-  std::push_heap(moves->begin(), moves->end(), CompareMoves);
+template <Colors kUs>
+MovePicker<kUs>::MovePicker(Board* board, Bitmove hash_move,
+                       const Bitmove killers[2])
+    : board_(board), stage_(kHashMove), hash_move_(hash_move),
+      killers_{killers[0], killers[1]}, cursor_(0), end_(0), bad_(0) {
+  if (killers_[1] == killers_[0]) {
+    killers_[1] = Bitmove();
+  }
 }
 
-// TODO: Turn into transposition table
-Move GetMove(Moves* moves) {
-  std::pop_heap(moves->begin(), moves->end(), CompareMoves);
-  Move move = moves->back();
-  moves->pop_back();
-  return move;
+template <Colors kUs>
+bool MovePicker<kUs>::Next(Bitmove* move) {
+  while (NextPseudoLegal(move)) {
+    if (board_->LeavesKingSafe<kUs>(*move)) {
+      return true;
+    }
+  }
+  return false;
 }
 
-bool operator==(const Move& a, const Move& b) {
-  return ((a.type == b.type) &&
-          (a.captured == b.captured) &&
-          (a.source == b.source) &&
-          (a.dest == b.dest));
+template <Colors kUs>
+bool MovePicker<kUs>::NextPseudoLegal(Bitmove* move) {
+  switch (stage_) {
+    case kHashMove:
+      stage_ = board_->InCheck() ? kGenerateEvasions : kGenerateCaptures;
+      if (board_->IsPseudoLegal(hash_move_)) {
+        *move = hash_move_;
+        return true;
+      }
+      return NextPseudoLegal(move);
+    case kGenerateCaptures:
+      end_ = board_->GenerateCaptures<kUs>(moves_.data());
+      for (int n = 0; n < end_; ++n) {
+        scores_[n] = board_->CaptureOrder(moves_[n]);
+      }
+      cursor_ = 0;
+      stage_ = kGoodCaptures;
+      // fallthrough
+    case kGoodCaptures:
+      while (cursor_ < end_) {
+        PickBest();
+        const Bitmove& m = moves_[cursor_++];
+        if (m == hash_move_)
+          continue;
+        Piece attacker = board_->GetPiece(m.source());
+        if (attacker.piece() != kKing &&
+            attacker.value() > board_->CaptureGain(m)) {
+          // Might lose the attacker, so wait until the quiets are done. Its
+          // slot has been read already, so the front of the buffer is free.
+          moves_[bad_++] = m;
+          continue;
+        }
+        *move = m;
+        return true;
+      }
+      stage_ = kKiller1;
+      // fallthrough
+    case kKiller1:
+      stage_ = kKiller2;
+      if (IsQuietKiller(killers_[0])) {
+        *move = killers_[0];
+        return true;
+      }
+      // fallthrough
+    case kKiller2:
+      stage_ = kGenerateQuiets;
+      if (IsQuietKiller(killers_[1])) {
+        *move = killers_[1];
+        return true;
+      }
+      // fallthrough
+    case kGenerateQuiets:
+      // After the parked captures. Together they're some of the pseudo-legal
+      // moves, which GenerateMoves() already holds to kMaxMoves.
+      end_ = bad_ + board_->GenerateQuiets<kUs>(moves_.data() + bad_);
+      DCHECK_LE(end_, kMaxMoves);
+      for (int n = bad_; n < end_; ++n) {
+        const Bitmove& m = moves_[n];
+        scores_[n] = g_history[m.from_to()];
+      }
+      cursor_ = bad_;
+      stage_ = kQuiets;
+      // fallthrough
+    case kQuiets:
+      while (cursor_ < end_) {
+        PickBest();
+        const Bitmove& m = moves_[cursor_++];
+        if (!IsSpecial(m)) {
+          *move = m;
+          return true;
+        }
+      }
+      // Parked from most to least promising.
+      cursor_ = 0;
+      stage_ = kBadCaptures;
+      // fallthrough
+    case kBadCaptures:
+      if (cursor_ < bad_) {
+        *move = moves_[cursor_++];
+        return true;
+      }
+      stage_ = kDone;
+      return false;
+    case kGenerateEvasions:
+      // Few enough that killers aren't worth it. Taking the checker usually
+      // beats running away, so captures and promotions go first.
+      end_ = board_->GenerateEvasions<kUs>(moves_.data());
+      for (int n = 0; n < end_; ++n) {
+        const Bitmove& m = moves_[n];
+        if (board_->IsQuiet(m)) {
+          scores_[n] = g_history[m.from_to()];
+        } else {
+          scores_[n] = kCaptureBonus + board_->CaptureOrder(m);
+        }
+      }
+      cursor_ = 0;
+      stage_ = kEvasions;
+      // fallthrough
+    case kEvasions:
+      while (cursor_ < end_) {
+        PickBest();
+        const Bitmove& m = moves_[cursor_++];
+        if (m != hash_move_) {
+          *move = m;
+          return true;
+        }
+      }
+      stage_ = kDone;
+      // fallthrough
+    case kDone:
+      return false;
+  }
+  return false;
 }
 
-string PrintMove(const Move& move) {
-  string res = "";
-  res += move.source.ToString();
-  res += "->";
-  res += move.dest.ToString();
-  res += " [" + kMoves[move.type] + "]";
-  return res;
+// Selection sort one step at a time. A cutoff usually comes early, so this
+// beats sorting every move up front.
+template <Colors kUs>
+void MovePicker<kUs>::PickBest() {
+  int best = cursor_;
+  for (int n = cursor_ + 1; n < end_; ++n) {
+    if (scores_[n] > scores_[best]) {
+      best = n;
+    }
+  }
+  std::swap(moves_[cursor_], moves_[best]);
+  std::swap(scores_[cursor_], scores_[best]);
 }
 
-std::ostream& operator<<(std::ostream& os, const MoveType& type) {
-  os << kMoves[type];
-  return os;
+template <Colors kUs>
+bool MovePicker<kUs>::IsSpecial(Bitmove move) const {
+  return (move == hash_move_ ||
+          move == killers_[0] ||
+          move == killers_[1]);
 }
 
-std::ostream& operator<<(std::ostream& os, const Move& move) {
-  os << PrintMove(move);
-  return os;
+template <Colors kUs>
+bool MovePicker<kUs>::IsQuietKiller(Bitmove killer) const {
+  return (killer != hash_move_ &&
+          board_->IsPseudoLegal(killer) &&
+          board_->IsQuiet(killer));
 }
 
+template class MovePicker<kWhite>;
+template class MovePicker<kBlack>;
+
 }  // namespace chessy
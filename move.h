@@ -1,63 +1,76 @@
-// move.h - move representation
+// move.h - move ordering
 // 2013.02.08
 
 #ifndef CHESSY_MOVE_H_
 #define CHESSY_MOVE_H_
 
-#include <queue>
-#include <vector>
-
-#include "chessy.h"
-#include "square.h"
+#include "bitmove.h"
+#include "piece.h"
 
 namespace chessy {
 
-enum MoveType {
-  kInvalidMove = 0,
-  kRegular = 1,
-  kAttack = 2,
-  kCastle = 3,
-  kCastleQueen = 4,
-  kCheck = 5,
-  kNullMove = 6,  // For null-move pruning and check conditions.
-  kTentative = 7,
-};
+class Board;
 
-const int kMoveTypes = 8;
+// How often each quiet move caused a beta cutoff, indexed by
+// Bitmove::from_to(). Deeper cutoffs count for more.
+extern int g_history[1 << 12];
 
-// Moves depend on the Board to be applied upon. Not all moves are valid for
-// any particular board position.
-struct Move {
-  Move() : type(kInvalidMove) {}
-  explicit Move(MoveType type) : type(type) {}
-  Move(MoveType type, Square source, Square dest) :
-      source(source), dest(dest),
-      type(type), captured(Piece()),
-      priority(0) {}
-  Move(MoveType type, Square source, Square dest, Piece captured);
+// Halves every history score, so a new search isn't ruled by old positions.
+void AgeHistory();
 
-  Square source;
-  Square dest;
-  MoveType type;
-  Piece captured;
-  int priority;  // Move ordering.
-};
+// Hands out the legal moves of a position one at a time, best guess first,
+// only generating a batch once the moves before it have been tried. Most
+// nodes that fail high do so on the first move or two, so they never pay for
+// the quiet moves at all.
+//
+// Order: hash move, captures that don't lose material, killers, quiet moves
+// by history, then captures where the attacker is worth more than the victim.
+// In check it's the hash move, then only evasions: captures first, then the
+// rest by history.
+//
+// kUs is the side to move, so generation and legality checks can use the
+// board's templates.
+template <Colors kUs>
+class MovePicker {
+ public:
+  // |hash_move| and |killers| come from tables and might not be legal here;
+  // Bitmove() means none. |board| must stay as it is between calls to Next().
+  MovePicker(Board* board, Bitmove hash_move, const Bitmove killers[2]);
+  MovePicker(const MovePicker&) = delete;
 
-const Move kBadMove;
+  // Returns false once every legal move has been handed out.
+  bool Next(Bitmove* move);
 
-// Use a priority queue for move ordering.
-// Comparison function required for *Move Ordering*.
-typedef std::priority_queue<Move> MoveHeap;
-typedef std::vector<Move> Moves;
-bool operator==(const Move& a, const Move& b);
+ private:
+  enum Stage {
+    kHashMove,
+    kGenerateCaptures,
+    kGoodCaptures,
+    kKiller1,
+    kKiller2,
+    kGenerateQuiets,
+    kQuiets,
+    kBadCaptures,
+    kGenerateEvasions,
+    kEvasions,
+    kDone,
+  };
 
-void AddMove(Moves* moves, const Move& move);
-Move GetMove(Moves* moves);
+  bool NextPseudoLegal(Bitmove* move);
+  void PickBest();  // Swaps the best remaining move to cursor_.
+  bool IsSpecial(Bitmove move) const;  // Already tried as hash or killer.
+  bool IsQuietKiller(Bitmove killer) const;
 
-std::string PrintMove(const Move& move);
-
-std::ostream& operator<<(std::ostream& os, const MoveType& type);
-std::ostream& operator<<(std::ostream& os, const Move& move);
+  Board* board_;
+  Stage stage_;
+  Bitmove hash_move_;
+  Bitmove killers_[2];
+  int cursor_;  // Next move to hand out from moves_.
+  int end_;  // Moves generated for the current stage.
+  int bad_;  // Bad captures parked at the front of moves_.
+  MoveBuffer moves_;
+  int scores_[kMaxMoves];
+};
 
 }  // namespace chessy
 
@@ -0,0 +1,95 @@
+#include "move.h"
+#include "board.h"
+#include "random_games.h"
+#include <algorithm>
+#include <cstdlib>
+#include <gtest/gtest.h>
+
+using namespace chessy;
+
+template <Colors kUs>
+static std::vector<Bitmove> Pick(Board* board, Bitmove hash_move,
+                                 const Bitmove killers[2]) {
+  std::vector<Bitmove> res;
+  MovePicker<kUs> picker(board, hash_move, killers);
+  Bitmove move;
+  while (picker.Next(&move)) {
+    res.push_back(move);
+  }
+  return res;
+}
+
+static std::vector<Bitmove> Pick(Board* board, Bitmove hash_move,
+                                 const Bitmove killers[2]) {
+  return ((board->color() == kWhite) ?
+          Pick<kWhite>(board, hash_move, killers) :
+          Pick<kBlack>(board, hash_move, killers));
+}
+
+static std::vector<Bitmove> Sorted(std::vector<Bitmove> moves) {
+  std::sort(moves.begin(), moves.end(), [](Bitmove a, Bitmove b) {
+    return a.bits() < b.bits();
+  });
+  return moves;
+}
+
+TEST(MovePickerTest, YieldsEveryLegalMoveOnce) {
+  std::srand(7);
+  ForEachRandomPosition(20, 80, [](Board* board, const MoveList& legal) {
+    if (legal.empty())
+      return;
+    std::vector<Bitmove> expected(legal.begin(), legal.end());
+    // Killers left over from some other position, which may not be legal.
+    Bitmove killers[2] = {
+      legal[std::rand() % legal.size()],
+      Bitmove(static_cast<uint16_t>(std::rand() & 0xffff)),
+    };
+    Bitmove hash_move = expected[std::rand() % expected.size()];
+    std::vector<Bitmove> picked = Pick(board, hash_move, killers);
+    ASSERT_EQ(Sorted(expected), Sorted(picked));
+    EXPECT_EQ(hash_move, picked.front());
+  });
+}
+
+TEST(MovePickerTest, CapturesBeforeQuiets) {
+  Board board;
+  const char* moves[][2] = {{"e2", "e4"}, {"d7", "d5"}, {"d1", "h5"},
+                            {"g8", "f6"}};
+  for (auto& m : moves) {
+    board = Board(board, board.ComposeMove(m[0], m[1]));
+  }
+  Bitmove killers[2];
+  std::vector<Bitmove> picked = Pick(&board, Bitmove(), killers);
+  ASSERT_FALSE(picked.empty());
+  // exd5 trades a pawn for a pawn. Qxf7+ and Qxh7 risk the queen for a pawn
+  // so come last, after all the quiet moves.
+  EXPECT_EQ(board.ComposeMove("e4", "d5"), picked.front());
+  std::vector<Bitmove> last(picked.end() - 2, picked.end());
+  std::vector<Bitmove> bad = {board.ComposeMove("h5", "f7"),
+                              board.ComposeMove("h5", "h7")};
+  EXPECT_EQ(Sorted(bad), Sorted(last));
+}
+
+TEST(MovePickerTest, EnPassantIsAGoodCapture) {
+  Board board;
+  ASSERT_TRUE(board.LoadFen("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1"));
+  Bitmove killers[2];
+  std::vector<Bitmove> picked = Pick(&board, Bitmove(), killers);
+  ASSERT_FALSE(picked.empty());
+  // Takes a pawn for a pawn, so it goes first, not with the bad captures.
+  EXPECT_EQ(board.ComposeMove("e5", "d6"), picked.front());
+}
+
+TEST(MovePickerTest, PromotionBeforeKillers) {
+  Board board;
+  ASSERT_TRUE(board.LoadFen("4k3/P7/8/8/8/8/8/4K3 w - - 0 1"));
+  Bitmove killers[2] = {board.ComposeMove("e1", "d1"),
+                        board.ComposeMove("e1", "f1")};
+  std::vector<Bitmove> picked = Pick(&board, Bitmove(), killers);
+  ASSERT_FALSE(picked.empty());
+  // Takes nothing, but still wins the most material of any move here.
+  Bitmove promote = board.ComposeMove("a7", "a8");
+  EXPECT_EQ(kQueen, promote.promotion());
+  EXPECT_EQ(promote, picked.front());
+  EXPECT_EQ(1u, std::count(picked.begin(), picked.end(), killers[0]));
+}
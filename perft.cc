@@ -0,0 +1,93 @@
+// perft.cc - counts move paths, for testing and timing move generation
+
+#include "perft.h"
+
+#include <thread>
+
+#include <glog/logging.h>
+
+namespace chessy {
+
+PerftTable::PerftTable(size_t megabytes) {
+  size_t count = 1;
+  while (count * 2 * sizeof(Entry) <= megabytes << 20) {
+    count *= 2;
+  }
+  entries_.reset(new Entry[count]);
+  for (size_t n = 0; n < count; ++n) {
+    entries_[n].check.store(0, std::memory_order_relaxed);
+    entries_[n].data.store(0, std::memory_order_relaxed);
+  }
+  mask_ = count - 1;
+}
+
+bool PerftTable::Probe(uint64_t key, int depth, uint64_t* nodes) const {
+  const Entry& entry = entries_[key & mask_];
+  uint64_t data = entry.data.load(std::memory_order_relaxed);
+  uint64_t check = entry.check.load(std::memory_order_relaxed);
+  if ((check ^ data) != key || (data & 0xff) != (uint64_t)depth)
+    return false;
+  *nodes = data >> 8;
+  return true;
+}
+
+void PerftTable::Store(uint64_t key, int depth, uint64_t nodes) {
+  Entry& entry = entries_[key & mask_];
+  uint64_t data = nodes << 8 | depth;
+  entry.check.store(key ^ data, std::memory_order_relaxed);
+  entry.data.store(data, std::memory_order_relaxed);
+}
+
+template <Colors kUs>
+static uint64_t Perft(Board* board, int depth, PerftTable* table) {
+  if (depth == 0)
+    return 1;
+  uint64_t nodes;
+  if (depth > 1 && table && table->Probe(board->Hash(), depth, &nodes))
+    return nodes;
+  MoveList moves = board->PossibleMoves<kUs>();
+  if (depth == 1)
+    return moves.size();  // Bulk counting: leaves needn't be played.
+  nodes = 0;
+  for (const Bitmove& move : moves) {
+    Board::Undo undo;
+    board->MakeMove<kUs>(move, &undo);
+    nodes += Perft<Toggle(kUs)>(board, depth - 1, table);
+    board->UnmakeMove<kUs>(move, undo);
+  }
+  if (table)
+    table->Store(board->Hash(), depth, nodes);
+  return nodes;
+}
+
+uint64_t Perft(Board* board, int depth, PerftTable* table) {
+  return ((board->color() == kWhite) ?
+          Perft<kWhite>(board, depth, table) :
+          Perft<kBlack>(board, depth, table));
+}
+
+std::vector<PerftDivision> Divide(const Board& board, int depth, int threads,
+                                  PerftTable* table) {
+  CHECK_GE(depth, 1);
+  MoveList moves = board.PossibleMoves();
+  std::vector<PerftDivision> res(moves.size());
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    for (size_t n; (n = next++) < moves.size();) {
+      Board child(board, moves[n]);
+      res[n].move = moves[n];
+      res[n].nodes = Perft(&child, depth - 1, table);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (int n = 1; n < threads; ++n) {
+    pool.emplace_back(work);
+  }
+  work();  // This thread pulls its weight too.
+  for (std::thread& thread : pool) {
+    thread.join();
+  }
+  return res;
+}
+
+}  // namespace chessy
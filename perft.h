@@ -0,0 +1,57 @@
+// perft.h - counts move paths, for testing and timing move generation
+
+#ifndef CHESSY_PERFT_H_
+#define CHESSY_PERFT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bitmove.h"
+#include "board.h"
+
+namespace chessy {
+
+// Remembers subtree counts by position, since perft sees the same positions
+// over and over through transpositions. Threads share one table without
+// locks: each entry stores its key XOR its data, so an entry torn by two
+// writers no longer matches any key and just reads as a miss.
+class PerftTable {
+ public:
+  explicit PerftTable(size_t megabytes);
+  PerftTable(const PerftTable&) = delete;
+
+  bool Probe(uint64_t key, int depth, uint64_t* nodes) const;
+  void Store(uint64_t key, int depth, uint64_t nodes);
+
+ private:
+  struct Entry {
+    std::atomic<uint64_t> check;  // key ^ data
+    std::atomic<uint64_t> data;   // Nodes in the top 56 bits, then depth.
+  };
+
+  std::unique_ptr<Entry[]> entries_;
+  uint64_t mask_;
+};
+
+// Counts the legal move paths |depth| plies deep from |board|, which is left
+// as it was. The last ply is counted without being played. |table| may be
+// null.
+uint64_t Perft(Board* board, int depth, PerftTable* table);
+
+struct PerftDivision {
+  Bitmove move;
+  uint64_t nodes;
+};
+
+// Perft of each root move, which is what you compare against another engine
+// to find where move generation goes wrong. Root moves are handed out one at
+// a time to a pool of |threads| workers. |depth| must be at least 1.
+std::vector<PerftDivision> Divide(const Board& board, int depth, int threads,
+                                  PerftTable* table);
+
+}  // namespace chessy
+
+#endif  // CHESSY_PERFT_H_
@@ -0,0 +1,68 @@
+#include "perft.h"
+#include <gtest/gtest.h>
+
+using namespace chessy;
+
+// Positions and counts from the Chess Programming Wiki's perft results page,
+// which every engine checks itself against. Each one stresses something:
+// castling, en passant, promotions, and pins along ranks.
+struct PerftCase {
+  const char* fen;
+  uint64_t nodes[5];  // From depth 1 up. Zero past what's worth the time.
+};
+
+static const PerftCase kCases[] = {
+  {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+   {20, 400, 8902, 197281}},
+  {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+   {48, 2039, 97862}},
+  {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+   {14, 191, 2812, 43238, 674624}},
+  {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+   {6, 264, 9467}},
+  {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+   {44, 1486, 62379}},
+  {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+   {46, 2079, 89890}},
+};
+
+TEST(PerftTest, ReferencePositions) {
+  for (const PerftCase& test : kCases) {
+    Board board;
+    ASSERT_TRUE(board.LoadFen(test.fen)) << test.fen;
+    uint64_t hash = board.Hash();
+    for (int depth = 1; depth <= 5 && test.nodes[depth - 1]; ++depth) {
+      EXPECT_EQ(test.nodes[depth - 1], Perft(&board, depth, nullptr))
+          << test.fen << " depth " << depth;
+    }
+    EXPECT_EQ(hash, board.Hash()) << test.fen;
+  }
+}
+
+// Threads and the cache must only change how fast the answer comes.
+TEST(PerftTest, DivideWithThreadsAndTable) {
+  const PerftCase& test = kCases[1];
+  Board board;
+  ASSERT_TRUE(board.LoadFen(test.fen));
+  PerftTable table(1);
+  for (int pass = 0; pass < 2; ++pass) {  // Second pass hits the cache.
+    uint64_t nodes = 0;
+    for (const PerftDivision& root : Divide(board, 3, 4, &table)) {
+      Board child(board, root.move);
+      EXPECT_EQ(Perft(&child, 2, nullptr), root.nodes) << root.move;
+      nodes += root.nodes;
+    }
+    EXPECT_EQ(test.nodes[2], nodes);
+  }
+}
+
+TEST(PerftTest, BadFen) {
+  Board board;
+  EXPECT_FALSE(board.LoadFen(""));
+  EXPECT_FALSE(board.LoadFen("8/8/8/8/8/8/8/8 w - - 0 1"));  // No kings.
+  EXPECT_FALSE(board.LoadFen("rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR "
+                             "w KQkq - 0 1"));
+  EXPECT_FALSE(board.LoadFen("4k3/8/8/8/8/8/8/4K3 x - - 0 1"));
+  EXPECT_FALSE(board.LoadFen("4k3/4R3/8/8/8/8/8/4K3 w - - 0 1"));  // Not
+  EXPECT_TRUE(board.LoadFen("4k3/4R3/8/8/8/8/8/4K3 b - - 0 1"));   // ours.
+}
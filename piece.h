@@ -46,7 +46,7 @@ const int kColors = 2;
 const int kPieces = 7;
 const int kCentipawn = 100;
 
-inline Colors Toggle(Colors color) {
+constexpr inline Colors Toggle(Colors color) {
   return (color == kWhite) ? kBlack : kWhite;
 }
 
@@ -0,0 +1,34 @@
+// random_games.h - positions from random games, for tests and benchmarks
+
+#ifndef CHESSY_RANDOM_GAMES_H_
+#define CHESSY_RANDOM_GAMES_H_
+
+#include <cstdlib>
+
+#include "bitmove.h"
+#include "board.h"
+
+namespace chessy {
+
+// Plays |games| games of up to |plies| random legal moves from the start,
+// calling check(&board, moves) on every position along the way, the last
+// one included. |moves| are the legal moves there, empty once the game is
+// over. The board may be changed as long as it's put back. Moves come from
+// std::rand(), so seed it first for the same games every run.
+template <typename F>
+void ForEachRandomPosition(int games, int plies, F check) {
+  for (int game = 0; game < games; ++game) {
+    Board board;
+    for (int ply = 0;; ++ply) {
+      MoveList moves = board.PossibleMoves();
+      check(&board, moves);
+      if (moves.empty() || ply == plies)
+        break;
+      board = Board(board, moves[std::rand() % moves.size()]);
+    }
+  }
+}
+
+}  // namespace chessy
+
+#endif  // CHESSY_RANDOM_GAMES_H_
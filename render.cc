@@ -7,7 +7,6 @@
 #include <sstream>
 
 #include "board.h"
-#include "move.h"
 #include "term.h"
 
 using std::cout;
@@ -109,8 +108,8 @@ string HumanMovePrompt() {
 
 void UpdateBoard(const Board& board, const Bitmove& move) {
   // Should be drawn *after* the real board update.
-  auto& source = move.source;
-  auto& dest = move.dest;
+  Square source = move.source();
+  Square dest = move.dest();
   const Piece& tile = board.GetPiece(dest);
   string glyph = ((tile.color() == kWhite)
                   ? term::kWhitePiece
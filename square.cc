@@ -12,7 +12,7 @@ const Square Square::kLeft    = Square( 0, -1);
 const Square Square::kRight   = Square( 0,  1);
 const Square Square::kInvalid = Square(0x88);
 
-Square::Square(std::string str) {
+Square::Square(std::string str) : x88_(static_cast<int8_t>(0x88)) {
   if (str.size() != 2)
     return;
   int file = std::tolower(str[0]) - 'a';
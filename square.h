@@ -34,6 +34,7 @@ class Square {
   constexpr inline int8_t x88() const   { return x88_;           }
   constexpr inline int rank() const     { return x88_ >> 4;      }
   constexpr inline int file() const     { return x88_ & 0x07;    }
+  constexpr inline int index() const    { return rank() * kRow + file(); }
   constexpr inline bool IsValid() const { return !(x88_ & 0x88); }
 
   constexpr inline bool operator==(Square other) const {
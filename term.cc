@@ -7,7 +7,7 @@
 namespace chessy {
 namespace term {
 
-std::string i2s(int x) {
+std::string i2s(int64_t x) {
   std::stringstream ss;
   ss << x;
   return ss.str();
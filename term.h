@@ -4,6 +4,7 @@
 #ifndef CHESSY_TERM_H_
 #define CHESSY_TERM_H_
 
+#include <cstdint>
 #include <string>
 
 #include "square.h"
@@ -12,7 +13,7 @@
 namespace chessy {
 namespace term {
 
-std::string i2s(int x);
+std::string i2s(int64_t x);
 std::string x2s(int x);
 
 // ANSI escape sequences for console drawing shenanigans.
@@ -0,0 +1,124 @@
+// transtable.cc - transposition table
+
+#include "transtable.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include <glog/logging.h>
+
+namespace chessy {
+
+TransTable g_transtable;
+
+static const int kAgeMask = 0x3f;
+
+void PutFirst(Bitmove move, MoveList* moves) {
+  if (!move.IsValid())
+    return;
+  for (Bitmove& other : *moves) {
+    if (other == move) {
+      std::swap(other, moves->front());
+      return;
+    }
+  }
+}
+
+TransTable::TransTable()
+    : clusters_(nullptr), mask_(0), age_(0), probes_(0), hits_(0) {
+  Resize(0);
+}
+
+TransTable::~TransTable() {
+  free(clusters_);
+}
+
+void TransTable::Resize(size_t megabytes) {
+  size_t count = 1;
+  while (count * 2 * sizeof(TransCluster) <= megabytes << 20) {
+    count *= 2;
+  }
+  free(clusters_);
+  void* memory = nullptr;
+  CHECK_EQ(0, posix_memalign(&memory, sizeof(TransCluster),
+                             count * sizeof(TransCluster)))
+      << "can't allocate " << megabytes << "mb transposition table";
+  clusters_ = static_cast<TransCluster*>(memory);
+  mask_ = count - 1;
+  Clear();
+}
+
+void TransTable::Clear() {
+  memset(reinterpret_cast<void*>(clusters_), 0,
+         (mask_ + 1) * sizeof(TransCluster));
+}
+
+void TransTable::NewSearch() {
+  age_ = (age_ + 1) & kAgeMask;
+  probes_ = 0;
+  hits_ = 0;
+}
+
+bool TransTable::Probe(uint64_t key, TransEntry* entry) {
+  ++probes_;
+  TransCluster& cluster = clusters_[key & mask_];
+  for (TransEntry& e : cluster.entries) {
+    if (e.key == key && e.bound() != kBoundNone) {
+      e.age_bound = (age_ << 2) | e.bound();  // Still useful; don't age out.
+      *entry = e;
+      ++hits_;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TransTable::Store(uint64_t key, int depth, int score, Bound bound,
+                       Bitmove move) {
+  TransCluster& cluster = clusters_[key & mask_];
+  TransEntry* victim = &cluster.entries[0];
+  int victim_worth = 0x7fffffff;
+  for (TransEntry& e : cluster.entries) {
+    if (e.key == key || e.bound() == kBoundNone) {
+      victim = &e;
+      break;
+    }
+    // Shallow results are cheap to recompute, and results from earlier
+    // searches are less likely to be reached again.
+    int stale = (age_ - e.age()) & kAgeMask;
+    int worth = e.depth - 8 * stale;
+    if (worth < victim_worth) {
+      victim = &e;
+      victim_worth = worth;
+    }
+  }
+  // Don't lose the best move just because this search didn't find one.
+  if (!move.IsValid() && victim->key == key) {
+    move = victim->move;
+  }
+  victim->key = key;
+  victim->score = score;
+  victim->move = move;
+  victim->depth = depth;
+  victim->age_bound = (age_ << 2) | bound;
+}
+
+// Looks at clusters spread evenly over the whole table. The first ones
+// alone would say more about where early keys happened to land.
+int TransTable::Fill() const {
+  const uint64_t kSamples = 1000 / TransCluster::kEntries;
+  uint64_t stride = std::max<uint64_t>(1, (mask_ + 1) / kSamples);
+  int samples = 0;
+  int used = 0;
+  for (uint64_t n = 0; n <= mask_ && samples < 1000; n += stride) {
+    for (const TransEntry& e : clusters_[n].entries) {
+      ++samples;
+      used += (e.bound() != kBoundNone && e.age() == age_);
+    }
+  }
+  return used * 1000 / samples;
+}
+
+}  // namespace chessy
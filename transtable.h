@@ -1,2 +1,84 @@
 // transtable.h -transposition table
 // 2013.02.08
+
+#ifndef CHESSY_TRANSTABLE_H_
+#define CHESSY_TRANSTABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bitmove.h"
+
+namespace chessy {
+
+// What a stored score says about the real value of a position.
+enum Bound {
+  kBoundNone  = 0,
+  kBoundUpper = 1,  // Failed low: real value <= score.
+  kBoundLower = 2,  // Failed high: real value >= score.
+  kBoundExact = 3,
+};
+
+// Moves |move|, if present, to the front of |moves|.
+void PutFirst(Bitmove move, MoveList* moves);
+
+struct TransEntry {
+  uint64_t key;
+  int32_t score;
+  Bitmove move;
+  int8_t depth;
+  uint8_t age_bound;  // Search generation in the top six bits, then Bound.
+
+  inline Bound bound() const { return static_cast<Bound>(age_bound & 3); }
+  inline int age() const { return age_bound >> 2; }
+};
+
+// Four entries share one cache line so a probe costs at most one miss.
+struct alignas(64) TransCluster {
+  static const int kEntries = 4;
+  TransEntry entries[kEntries];
+};
+
+static_assert(sizeof(TransCluster) == 64, "cluster must fill a cache line");
+
+class TransTable {
+ public:
+  TransTable();
+  TransTable(const TransTable&) = delete;
+  ~TransTable();
+
+  // Reallocates to the largest power-of-two cluster count that fits. Clears.
+  void Resize(size_t megabytes);
+  void Clear();
+
+  // Called before each search. Entries from older searches are replaced
+  // first and don't count towards Fill().
+  void NewSearch();
+
+  bool Probe(uint64_t key, TransEntry* entry);
+  void Store(uint64_t key, int depth, int score, Bound bound, Bitmove move);
+
+  // Starts pulling a cluster into cache. Call this as soon as a child's key
+  // is known so the load overlaps with making the move.
+  inline void Prefetch(uint64_t key) const {
+    __builtin_prefetch(&clusters_[key & mask_]);
+  }
+
+  int Fill() const;  // Permille of entries used by the current search.
+  inline uint64_t probes() const { return probes_; }
+  inline uint64_t hits() const { return hits_; }
+  inline size_t size() const { return (mask_ + 1) * sizeof(TransCluster); }
+
+ private:
+  TransCluster* clusters_;
+  uint64_t mask_;
+  uint8_t age_;
+  uint64_t probes_;
+  uint64_t hits_;
+};
+
+extern TransTable g_transtable;
+
+}  // namespace chessy
+
+#endif  // CHESSY_TRANSTABLE_H_
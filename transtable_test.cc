@@ -0,0 +1,60 @@
+#include "transtable.h"
+#include <gtest/gtest.h>
+
+using namespace chessy;
+
+TEST(TransTableTest, StoreThenProbe) {
+  TransTable table;
+  table.Resize(1);
+  table.NewSearch();
+  TransEntry entry;
+  EXPECT_FALSE(table.Probe(42, &entry));
+  table.Store(42, 3, -17, kBoundLower, Bitmove(0x123));
+  ASSERT_TRUE(table.Probe(42, &entry));
+  EXPECT_EQ(3, entry.depth);
+  EXPECT_EQ(-17, entry.score);
+  EXPECT_EQ(kBoundLower, entry.bound());
+  EXPECT_EQ(Bitmove(0x123), entry.move);
+  EXPECT_EQ(2u, table.probes());
+  EXPECT_EQ(1u, table.hits());
+}
+
+TEST(TransTableTest, ReplacesShallowestStaleEntry) {
+  TransTable table;
+  table.Resize(0);  // One cluster, so every key collides.
+  table.NewSearch();
+  for (int n = 0; n < TransCluster::kEntries; ++n) {
+    table.Store(n + 1, 10 + n, 0, kBoundExact, Bitmove());
+  }
+  table.NewSearch();
+  table.Store(100, 1, 0, kBoundExact, Bitmove());
+  TransEntry entry;
+  EXPECT_FALSE(table.Probe(1, &entry));  // Shallowest of the old search.
+  EXPECT_TRUE(table.Probe(2, &entry));
+  EXPECT_TRUE(table.Probe(100, &entry));
+}
+
+TEST(TransTableTest, KeepsMoveWhenStoreHasNone) {
+  TransTable table;
+  table.Resize(1);
+  table.Store(7, 2, 5, kBoundExact, Bitmove(0x42));
+  table.Store(7, 4, 9, kBoundUpper, Bitmove());
+  TransEntry entry;
+  ASSERT_TRUE(table.Probe(7, &entry));
+  EXPECT_EQ(Bitmove(0x42), entry.move);
+  EXPECT_EQ(4, entry.depth);
+}
+
+// Fill() samples the whole table, so entries at the far end count too.
+TEST(TransTableTest, FillSeesWholeTable) {
+  TransTable table;
+  table.Resize(1);
+  table.NewSearch();
+  uint64_t clusters = table.size() / sizeof(TransCluster);
+  for (uint64_t n = clusters / 2; n < clusters; ++n) {
+    for (uint64_t i = 1; i <= TransCluster::kEntries; ++i) {
+      table.Store(n | i << 32, 1, 0, kBoundExact, Bitmove());
+    }
+  }
+  EXPECT_NEAR(500, table.Fill(), 10);
+}
@@ -0,0 +1,39 @@
+// zobrist.cc - position hash keys
+
+#include "zobrist.h"
+
+namespace chessy {
+
+uint64_t g_zobrist_pieces[16][64];
+uint64_t g_zobrist_black;
+uint64_t g_zobrist_castling[16];
+uint64_t g_zobrist_en_passant[8];
+
+// SplitMix64. Keys are the same from run to run so hashes can be compared
+// across processes and bugs reproduce.
+static uint64_t NextKey(uint64_t* state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+void InitZobrist() {
+  uint64_t state = 0;
+  for (int piece = 0; piece < 16; ++piece) {
+    for (int square = 0; square < 64; ++square) {
+      // Empty squares hash to nothing, so captures need no special case.
+      g_zobrist_pieces[piece][square] =
+          ((piece & 7) == kEmpty) ? 0 : NextKey(&state);
+    }
+  }
+  g_zobrist_black = NextKey(&state);
+  for (int n = 0; n < 16; ++n) {
+    g_zobrist_castling[n] = NextKey(&state);
+  }
+  for (int n = 0; n < 8; ++n) {
+    g_zobrist_en_passant[n] = NextKey(&state);
+  }
+}
+
+}  // namespace chessy
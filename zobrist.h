@@ -0,0 +1,33 @@
+// zobrist.h - position hash keys
+
+#ifndef CHESSY_ZOBRIST_H_
+#define CHESSY_ZOBRIST_H_
+
+#include <cstdint>
+
+#include "piece.h"
+#include "square.h"
+
+namespace chessy {
+
+// A position's key is the XOR of one random number per feature it has, so a
+// move only has to XOR out what it removes and XOR in what it adds.
+extern uint64_t g_zobrist_pieces[16][64];  // Indexed by Piece::bits().
+extern uint64_t g_zobrist_black;           // Black to move.
+extern uint64_t g_zobrist_castling[16];    // One per castling rights mask.
+extern uint64_t g_zobrist_en_passant[8];   // One per en passant file.
+
+void InitZobrist();  // Called by InitBitmoves().
+
+inline uint64_t ZobristKey(Piece piece, Square square) {
+  return g_zobrist_pieces[piece.bits()][square.index()];
+}
+
+// Key for the en passant square, or nothing if |square| is invalid.
+inline uint64_t ZobristEnPassant(Square square) {
+  return square.IsValid() ? g_zobrist_en_passant[square.file()] : 0;
+}
+
+}  // namespace chessy
+
+#endif  // CHESSY_ZOBRIST_H_